@@ -0,0 +1,159 @@
+/**
+ * Mozart++ Template Library: Core Library/Hash
+ * Licensed under Apache 2.0
+ * Copyright (C) 2020-2021 Chengdu Covariant Technologies Co., LTD.
+ * Website: https://covariant.cn/
+ * Github:  https://github.com/chengdu-zhirui/
+ */
+
+#pragma once
+
+#include "base.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#if defined(_MSC_VER) && defined(_M_X64)
+#include <intrin.h>
+#endif
+
+namespace mpp_impl {
+    /**
+     * 64x64 -> 128 bit multiplication, folded back to 64 bits.
+     */
+    inline std::uint64_t hash_mum(std::uint64_t a, std::uint64_t b) {
+#if defined(__SIZEOF_INT128__)
+        unsigned __int128 r = static_cast<unsigned __int128>(a) * b;
+        return static_cast<std::uint64_t>(r) ^ static_cast<std::uint64_t>(r >> 64);
+#elif defined(_MSC_VER) && defined(_M_X64)
+        std::uint64_t hi;
+        std::uint64_t lo = _umul128(a, b, &hi);
+        return lo ^ hi;
+#else
+        std::uint64_t ha = a >> 32, la = a & 0xffffffffu, hb = b >> 32, lb = b & 0xffffffffu;
+        std::uint64_t rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb;
+        std::uint64_t t = rl + (rm0 << 32), c = t < rl;
+        std::uint64_t lo = t + (rm1 << 32);
+        c += lo < t;
+        std::uint64_t hi = rh + (rm0 >> 32) + (rm1 >> 32) + c;
+        return lo ^ hi;
+#endif
+    }
+
+    inline std::uint64_t hash_read64(const unsigned char *p) {
+        std::uint64_t v;
+        std::memcpy(&v, p, sizeof(v));
+        return v;
+    }
+
+    inline std::uint64_t hash_read32(const unsigned char *p) {
+        std::uint32_t v;
+        std::memcpy(&v, p, sizeof(v));
+        return v;
+    }
+
+    /**
+     * A fast non-cryptographic hash over a byte range, in the style of
+     * wyhash: 16 bytes are consumed per 128 bit multiplication, and
+     * inputs of up to 16 bytes take a single multiplication and no loop.
+     * The value is not stable across library versions or platforms
+     * (the byte order is the host's), so it must not be persisted.
+     */
+    inline std::uint64_t hash_bytes(const void *data, std::size_t length, std::uint64_t seed = 0) {
+        static constexpr std::uint64_t secret[4] = {
+                0xa0761d6478bd642full, 0xe7037ed1a0b428dbull,
+                0x8ebc6af09c88c6e3ull, 0x589965cc75374cc3ull};
+
+        const unsigned char *p = static_cast<const unsigned char *>(data);
+        seed ^= hash_mum(seed ^ secret[0], secret[1]);
+        std::uint64_t a = 0, b = 0;
+        if (length <= 16) {
+            if (length >= 4) {
+                std::size_t mid = (length >> 3) << 2;
+                a = (hash_read32(p) << 32) | hash_read32(p + mid);
+                b = (hash_read32(p + length - 4) << 32) | hash_read32(p + length - 4 - mid);
+            } else if (length > 0) {
+                a = (std::uint64_t(p[0]) << 16) | (std::uint64_t(p[length >> 1]) << 8) | p[length - 1];
+            }
+        } else {
+            std::size_t i = length;
+            if (i > 48) {
+                std::uint64_t seed1 = seed, seed2 = seed;
+                do {
+                    seed = hash_mum(hash_read64(p) ^ secret[1], hash_read64(p + 8) ^ seed);
+                    seed1 = hash_mum(hash_read64(p + 16) ^ secret[2], hash_read64(p + 24) ^ seed1);
+                    seed2 = hash_mum(hash_read64(p + 32) ^ secret[3], hash_read64(p + 40) ^ seed2);
+                    p += 48;
+                    i -= 48;
+                } while (i > 48);
+                seed ^= seed1 ^ seed2;
+            }
+            while (i > 16) {
+                seed = hash_mum(hash_read64(p) ^ secret[1], hash_read64(p + 8) ^ seed);
+                p += 16;
+                i -= 16;
+            }
+            a = hash_read64(p + i - 16);
+            b = hash_read64(p + i - 8);
+        }
+        return hash_mum(secret[1] ^ length, hash_mum(a ^ secret[1], b ^ seed));
+    }
+
+    constexpr std::uint64_t hash_fnv1a(const char *str, std::uint64_t h = 0xcbf29ce484222325ull) {
+        while (*str != '\0') {
+            h ^= static_cast<unsigned char>(*str++);
+            h *= 0x100000001b3ull;
+        }
+        return h;
+    }
+
+    /**
+     * The signature of this function names T, so its hash tells types
+     * apart at compile time, without typeid.
+     */
+    template <typename T>
+    constexpr std::uint64_t type_signature_hash() {
+#if defined(_MSC_VER)
+        return hash_fnv1a(__FUNCSIG__);
+#else
+        return hash_fnv1a(__PRETTY_FUNCTION__);
+#endif
+    }
+}
+
+namespace mpp {
+    /**
+     * Finalise a hash value: every input bit affects every output bit.
+     * The mixing is a bijection (the finaliser of splitmix64), so with
+     * a 64 bit size_t distinct inputs never collide, e.g. integers.
+     */
+    constexpr std::size_t hash_mix(std::uint64_t x) {
+        x ^= x >> 30;
+        x *= 0xbf58476d1ce4e5b9ull;
+        x ^= x >> 27;
+        x *= 0x94d049bb133111ebull;
+        x ^= x >> 31;
+        return static_cast<std::size_t>(x);
+    }
+
+    /**
+     * Mix a hash value into a seed, e.g. to hash the members of a struct.
+     * The order matters: combining a then b differs from b then a.
+     */
+    constexpr std::size_t hash_combine(std::size_t seed, std::size_t value) {
+        return hash_mix(seed ^ (value + 0x9e3779b97f4a7c15ull + (std::uint64_t(seed) << 6) + (seed >> 2)));
+    }
+
+    /**
+     * A hash of the type itself, a compile-time constant.
+     * Equal in every shared library built by the same compiler.
+     */
+    template <typename T>
+    struct type_hash {
+        static constexpr std::size_t value = static_cast<std::size_t>(mpp_impl::type_signature_hash<T>());
+    };
+
+    template <typename T>
+    constexpr std::size_t type_hash<T>::value;
+}
@@ -11,6 +11,14 @@
 #include <mozart++/core>
 #include <mozart++/memory>
 #include <typeindex>
+#include <vector>
+
+/**
+ * Size of the inline buffer in mpp::any, two pointers by default
+ */
+#ifndef MOZART_ANY_INLINE_SIZE
+#define MOZART_ANY_INLINE_SIZE (2 * sizeof(void *))
+#endif
 
 namespace mpp_impl {
     // To String
@@ -70,49 +78,78 @@ namespace mpp_impl {
         static constexpr bool value = match<_Tp>(nullptr);
     };
 
+    template <typename T, typename = void>
+    struct has_hash_value : std::false_type {
+    };
+
     template <typename T>
-    struct hash_gen_base {
-        std::size_t base_code = typeid(T).hash_code();
+    struct has_hash_value<T, mpp::requires_all<decltype(hash_value(std::declval<const T &>()))>>
+            : std::true_type {
     };
 
-    template <typename, typename, bool>
+#if defined(__cpp_lib_has_unique_object_representations)
+    template <typename T>
+    using has_unique_bytes = std::has_unique_object_representations<T>;
+#elif (defined(__GNUC__) && __GNUC__ >= 7) || defined(__clang__) || (defined(_MSC_VER) && _MSC_VER >= 1911)
+    template <typename T>
+    using has_unique_bytes = std::integral_constant<bool, __has_unique_object_representations(T)>;
+#else
+    template <typename T>
+    using has_unique_bytes = std::false_type;
+#endif
+
+    /**
+     * How values of T are hashed, the first that applies:
+     * 0: hash_value(const T &) found by argument-dependent lookup
+     * 1: enums, by the underlying value
+     * 2: std::hash<T>
+     * 3: the object bytes, for types equal values of which have equal bytes
+     * 4: no hash at all
+     */
+    template <typename T>
+    struct hash_kind : std::integral_constant<int,
+            has_hash_value<T>::value ? 0 :
+            std::is_enum<T>::value ? 1 :
+            hash_helper<T>::value ? 2 :
+            has_unique_bytes<T>::value ? 3 : 4> {
+    };
+
+    template <typename, int>
     struct hash_if;
 
-    template <typename T, typename X>
-    struct hash_if<T, X, true> {
-        static std::size_t hash(const X &val) {
-            static std::hash<T> gen;
-            static hash_gen_base<X> genBase;
-            return gen(static_cast<const T>(val)) + genBase.base_code;
+    template <typename T>
+    struct hash_if<T, 0> {
+        static std::size_t hash(const T &val) {
+            return mpp::hash_mix(hash_value(val));
         }
     };
 
     template <typename T>
-    struct hash_if<T, T, true> {
+    struct hash_if<T, 1> {
         static std::size_t hash(const T &val) {
-            static std::hash<T> gen;
-            return gen(val);
+            return mpp::hash_mix(static_cast<std::uint64_t>(static_cast<std::underlying_type_t<T>>(val)));
         }
     };
 
-    template <typename T, typename X>
-    struct hash_if<T, X, false> {
-        static std::size_t hash(const X &val) {
-            return 0;
+    template <typename T>
+    struct hash_if<T, 2> {
+        static std::size_t hash(const T &val) {
+            return mpp::hash_mix(std::hash<T>()(val));
         }
     };
 
-    template <typename, bool>
-    struct hash_enum_resolver;
-
     template <typename T>
-    struct hash_enum_resolver<T, true> {
-        using type = hash_if<std::size_t, T, true>;
+    struct hash_if<T, 3> {
+        static std::size_t hash(const T &val) {
+            return static_cast<std::size_t>(hash_bytes(&val, sizeof(T)));
+        }
     };
 
     template <typename T>
-    struct hash_enum_resolver<T, false> {
-        using type = hash_if<T, T, hash_helper<T>::value>;
+    struct hash_if<T, 4> {
+        static std::size_t hash(const T &) {
+            return 0;
+        }
     };
 }
 
@@ -122,22 +159,39 @@ namespace mpp {
         return mpp_impl::to_string_if<T, mpp_impl::to_string_helper<T>::value>::to_string(val);
     }
 
+    /**
+     * Hash function of mpp::hash(), specialize it to customize the hash
+     * of a type, or declare a hash_value(const T &) function next to the
+     * type instead. A specialization should return well mixed values,
+     * see mpp::hash_mix() and mpp::hash_combine(); the results of
+     * hash_value() are mixed by mpp::hash().
+     * Values of types without any hash all hash to 0.
+     */
+    template <typename T>
+    struct hasher {
+        std::size_t operator()(const T &val) const {
+            return mpp_impl::hash_if<T, mpp_impl::hash_kind<T>::value>::hash(val);
+        }
+    };
+
     template <typename T>
     static std::size_t hash(const T &val) {
-        using type = typename mpp_impl::hash_enum_resolver<T, std::is_enum<T>::value>::type;
-        return type::hash(val);
+        return hasher<T>()(val);
     }
 
     class any;
 
     class any_ref;
+
+    class any_vector;
 }
 
 class mpp::any final {
 public:
     using typeid_t = std::type_index;
     /**
-     * Buffer pool size, too large value may be appropriate for the reverse
+     * Cache size of the allocator, unused by the default one: the slab
+     * heap below it keeps per-thread caches of its own
      */
     static constexpr size_t default_allocate_buffer_size = 16;
     /**
@@ -148,254 +202,235 @@ public:
      * @tparam DataType
      */
     template <typename T>
-    using default_allocator_provider = mpp::allocator<T>;
+    using default_allocator_provider = mpp::slab_allocator<T>;
     /**
-     * Unified definition
+     * Unified definition, safe to allocate and free from different threads
      */
     template <typename T>
-    using default_allocator = allocator_type<T, default_allocate_buffer_size, default_allocator_provider>;
+    using default_allocator = plain_allocator_type<T, default_allocate_buffer_size, default_allocator_provider>;
 
-private:
     /**
-     * Data storage base class
-     * The key to using polymorphism for type erasers is to abstract out type-independent interfaces
-     * This class is an interface class, or a pure virtual base class
+     * Size of the inline buffer: values that fit and can be moved
+     * without throwing are stored inside the any, without any allocation.
      */
-    class stor_base {
-    public:
-        /**
-         * Default constructor, directly using the default version
-         */
-        stor_base() = default;
+    static constexpr size_t inline_size = MOZART_ANY_INLINE_SIZE;
 
-        /**
-         * Copy the constructor, using the default version directly
-         */
-        stor_base(const stor_base &) = default;
+private:
+    /*
+     * Small object optimization
+     */
+    union stor_union {
+        // raw memory for small values
+        alignas(alignof(void *) > alignof(double) ? alignof(void *) : alignof(double))
+        unsigned char data[inline_size];
+        // or storing on heap
+        void *ptr;
+    };
 
-        /**
-         * Destructor, declared as a virtual function and implemented using default
-         */
-        virtual ~stor_base() = default;
+    /**
+     * Type-dependent operations on the stored data.
+     * One static table per type replaces a vtable in the stored object,
+     * so the inline buffer holds nothing but the value.
+     */
+    struct stor_ops {
+        const std::type_info *type;
 
-        /**
-         * RTTI type function
-         *
-         * @return std::type_index
-         */
-        virtual std::type_index type() const noexcept = 0;
+        void (*destroy)(stor_union &) noexcept;
 
-        /**
-         * Suicide function, freeing up resources
-         *
-         * @param isEnabled is Small Data Optimize enabled
-         */
-        virtual void suicide(bool) = 0;
+        // construct a copy of the value in an empty stor_union
+        void (*copy)(const stor_union &, stor_union &);
 
-        /**
-         * The clone function constructs a clone of the current object at the specified address
-         *
-         * @param TargetAddress
-         */
-        virtual void clone(byte_t *) const = 0;
+        // move the value to an empty stor_union and destroy the source,
+        // nullptr if copying the bytes of the stor_union does the same
+        void (*move)(stor_union &, stor_union &) noexcept;
 
-        /**
-         * The clone function constructs a clone of the current object and returns it
-         *
-         * @return pointer of new object
-         */
-        virtual stor_base *clone() const = 0;
+        std::string (*to_string)(const stor_union &);
 
-        /**
-         * Convert data to string
-         *
-         * @return text in std::string
-         */
-        virtual std::string to_string() const = 0;
+        std::size_t (*hash)(const stor_union &);
+    };
 
-        /**
-         * Calculate hash value of data
-         *
-         * @return hash value in std::size_t
-         */
-        virtual std::size_t hash() const = 0;
+    template <typename T>
+    struct stor_inline : std::integral_constant<bool,
+            sizeof(T) <= inline_size && alignof(stor_union) % alignof(T) == 0 &&
+            std::is_nothrow_move_constructible<T>::value> {
     };
 
     /**
-     * Data store template derived classes
-     * Concrete implementation of storing data
-     * This class takes advantage of the properties of the template class to automatically generate the desired derived classes
+     * Data storage, inline or on heap depending on the type
      *
-     * @tparam DataType
+     * @tparam T: Stored Type
      */
+    template <typename T, bool = stor_inline<T>::value>
+    struct stor_impl;
+
     template <typename T>
-    class stor_impl : public stor_base {
-    public:
-        /**
-         * The actual stored data
-         */
-        T data;
+    struct stor_impl<T, true> {
+        static T *data(stor_union &stor) noexcept {
+            return reinterpret_cast<T *>(stor.data);
+        }
 
-        /**
-         * Static Allocator
-         */
-        static default_allocator<stor_impl<T>> &get_allocator() {
-            static default_allocator<stor_impl<T>> allocator;
-            return allocator;
+        static const T *data(const stor_union &stor) noexcept {
+            return reinterpret_cast<const T *>(stor.data);
         }
 
-        /**
-         * Default constructor, implemented using default
-         */
-        stor_impl() = default;
+        template <typename ...ArgsT>
+        static void create(stor_union &stor, ArgsT &&...args) {
+            ::new(stor.data) T(std::forward<ArgsT>(args)...);
+        }
 
-        /**
-         * Destructor, implemented using default
-         */
-        ~stor_impl() override = default;
+        static void destroy(stor_union &stor) noexcept {
+            data(stor)->~T();
+            MOZART_LOGEV("Any Small Data Recycled.")
+        }
 
-        /**
-         * Disable the copy constructor
-         */
-        stor_impl(const stor_impl &) = delete;
+        static void move(stor_union &src, stor_union &dst) noexcept {
+            ::new(dst.data) T(std::move(*data(src)));
+            data(src)->~T();
+        }
 
-        stor_impl(const T &dat) : data(dat) {}
+        static constexpr auto move_ptr = std::is_trivially_copyable<T>::value ? nullptr : &move;
+    };
 
-        std::type_index type() const noexcept override {
-            return typeid(T);
+    template <typename T>
+    struct stor_impl<T, false> {
+        /**
+         * Static Allocator
+         */
+        static default_allocator<T> &get_allocator() {
+            static default_allocator<T> allocator;
+            return allocator;
         }
 
-        void suicide(bool is_static) override {
-            if (is_static)
-                this->~stor_impl();
-            else
-                get_allocator().free(this);
+        static T *data(stor_union &stor) noexcept {
+            return static_cast<T *>(stor.ptr);
         }
 
-        void clone(byte_t *ptr) const override {
-            ::new(ptr) stor_impl<T>(data);
+        static const T *data(const stor_union &stor) noexcept {
+            return static_cast<const T *>(stor.ptr);
         }
 
-        stor_base *clone() const override {
-            return get_allocator().alloc(data);
+        template <typename ...ArgsT>
+        static void create(stor_union &stor, ArgsT &&...args) {
+            stor.ptr = get_allocator().alloc(std::forward<ArgsT>(args)...);
         }
 
-        std::string to_string() const override {
-            return mpp::to_string(data);
+        static void destroy(stor_union &stor) noexcept {
+            get_allocator().free(data(stor));
+            MOZART_LOGEV("Any Normal Data Recycled.")
         }
 
-        std::size_t hash() const override {
-            return mpp::hash(data);
-        }
+        // the pointer is moved
+        static constexpr void (*move_ptr)(stor_union &, stor_union &) noexcept = nullptr;
     };
 
-    /*
-     * Small object optimization
-    */
+    template <typename T>
+    struct stor_table {
+        using impl = stor_impl<T>;
 
-    /**
-     * No data/optimization not triggered/optimization triggered
-     */
-    enum class stor_status {
-        null,
-        ptr,
-        data
-    };
+        static void copy(const stor_union &src, stor_union &dst) {
+            impl::create(dst, *impl::data(src));
+        }
 
-    struct stor_union {
-        // threshold of small object optimization, which must be greater than
-        // std::alignment_of<stor_base *>::value
-        static constexpr unsigned int static_stor_size = std::alignment_of<stor_base *>::value;
+        static std::string to_string(const stor_union &stor) {
+            return mpp::to_string(*impl::data(stor));
+        }
 
-        union {
-            // raw memory
-            unsigned char data[static_stor_size] = {0};
-            // or storing on heap
-            stor_base *ptr;
-        } impl;
+        static std::size_t hash(const stor_union &stor) {
+            return mpp::hash_combine(mpp::type_hash<T>::value, mpp::hash(*impl::data(stor)));
+        }
 
-        stor_status status = stor_status::null;
+        static constexpr stor_ops ops = {&typeid(T), &impl::destroy, &copy, impl::move_ptr, &to_string, &hash};
     };
 
     stor_union m_data;
+    const stor_ops *m_ops = nullptr;
 
-    /**
-     * @return Return inner pointer inside stor_base
-     */
-    inline stor_base *get_handler() {
-        switch (m_data.status) {
-            case stor_status::null:
-                throw_ex<mpp::runtime_error>("Access null any object.");
-            case stor_status::data:
-                return reinterpret_cast<stor_base *>(m_data.impl.data);
-            case stor_status::ptr:
-                return m_data.impl.ptr;
+    inline void recycle() {
+        if (m_ops != nullptr) {
+            m_ops->destroy(m_data);
+            m_ops = nullptr;
         }
-        return nullptr;
     }
 
-    inline const stor_base *get_handler() const {
-        switch (m_data.status) {
-            case stor_status::null:
-                throw_ex<mpp::runtime_error>("Access null any object.");
-            case stor_status::data:
-                return reinterpret_cast<const stor_base *>(m_data.impl.data);
-            case stor_status::ptr:
-                return m_data.impl.ptr;
-        }
-        return nullptr;
+    template <typename T, typename ...ArgsT>
+    inline void store(ArgsT &&...args) {
+        static_assert(std::is_copy_constructible<T>::value, "mpp::any: the value type must be copy constructible");
+        stor_impl<T>::create(m_data, std::forward<ArgsT>(args)...);
+        m_ops = &stor_table<T>::ops;
     }
 
-    inline void recycle() {
-        if (m_data.status != stor_status::null) {
-            get_handler()->suicide(m_data.status == stor_status::data);
-            MOZART_LOGEV(m_data.status == stor_status::data ? "Any Small Data Recycled." : "Any Normal Data Recycled.")
+    /**
+     * Take the value of an any, leaving it empty. Never allocates.
+     */
+    inline void steal(any &val) noexcept {
+        if (val.m_ops != nullptr) {
+            if (val.m_ops->move == nullptr)
+                m_data = val.m_data;
+            else
+                val.m_ops->move(val.m_data, m_data);
+            m_ops = val.m_ops;
+            val.m_ops = nullptr;
         }
     }
 
     template <typename T>
-    inline void store(const T &val, char(*)[sizeof(stor_impl<T>) <= stor_union::static_stor_size] = 0) {
-        ::new(m_data.impl.data) stor_impl<T>(val);
-        m_data.status = stor_status::data;
-        MOZART_LOGEV("Any SDO Enabled.")
-    }
+    struct is_in_place_tag : std::false_type {
+    };
 
     template <typename T>
-    inline void store(const T &val, char(*)[sizeof(stor_impl<T>) > stor_union::static_stor_size] = 0) {
-        m_data.impl.ptr = stor_impl<T>::get_allocator().alloc(val);
-        m_data.status = stor_status::ptr;
-        MOZART_LOGEV("Any SDO Disabled.")
-    }
+    struct is_in_place_tag<mpp_impl::in_place_t(*)(mpp_impl::in_place_type_tag<T>)> : std::true_type {
+    };
+
+    /**
+     * Values are stored decayed, any and in-place tags are not values.
+     */
+    template <typename T>
+    using requires_value = mpp::requires_true<!std::is_same<std::decay_t<T>, any>::value &&
+                                              !is_in_place_tag<std::decay_t<T>>::value>;
 
     inline void copy(const any &data) {
-        if (data.m_data.status != stor_status::null) {
-            const stor_base *ptr = data.get_handler();
-            if (data.m_data.status == stor_status::ptr) {
-                recycle();
-                m_data.impl.ptr = ptr->clone();
-                MOZART_LOGEV("Any Normal Data Copied.")
-            } else {
-                ptr->clone(m_data.impl.data);
-                MOZART_LOGEV("Any Small Data Copied.")
-            }
-            m_data.status = data.m_data.status;
+        recycle();
+        if (data.m_ops != nullptr) {
+            data.m_ops->copy(data.m_data, m_data);
+            m_ops = data.m_ops;
+        }
+    }
+
+    template <typename T>
+    inline void check_type() const {
+        if (!holds<T>()) {
+            if (m_ops == nullptr)
+                throw_ex<mpp::runtime_error>("Access null any object.");
+            throw_ex<mpp::runtime_error>("Access wrong type of any.");
         }
     }
 
 public:
     inline void swap(any &val) noexcept {
-        mpp::swap(m_data, val.m_data);
+        if (&val != this) {
+            any tmp(std::move(val));
+            val.steal(*this);
+            steal(tmp);
+        }
     }
 
     inline void swap(any &&val) noexcept {
-        mpp::swap(m_data, val.m_data);
+        swap(val);
     }
 
-    constexpr any() = default;
+    any() noexcept = default;
 
-    template <typename T>
-    /*implicit*/ any(const T &val) {
-        store(val);
+    template <typename T, typename = requires_value<T>>
+    /*implicit*/ any(T &&val) {
+        store<std::decay_t<T>>(std::forward<T>(val));
+    }
+
+    /**
+     * Construct the value of type T in place from args.
+     */
+    template <typename T, typename ...ArgsT>
+    explicit any(mpp_in_place_type_t(T), ArgsT &&...args) {
+        store<T>(std::forward<ArgsT>(args)...);
     }
 
     any(const any &val) {
@@ -403,17 +438,17 @@ public:
     }
 
     any(any &&val) noexcept {
-        swap(val);
+        steal(val);
     }
 
     ~any() {
         recycle();
     }
 
-    template <typename T>
-    inline any &operator=(const T &val) {
+    template <typename T, typename = requires_value<T>>
+    inline any &operator=(T &&val) {
         recycle();
-        store(val);
+        store<std::decay_t<T>>(std::forward<T>(val));
         return *this;
     }
 
@@ -424,50 +459,149 @@ public:
     }
 
     inline any &operator=(any &&val) noexcept {
-        swap(val);
+        if (&val != this) {
+            recycle();
+            steal(val);
+        }
         return *this;
     }
 
+    /**
+     * Replace the value with a T constructed in place from args.
+     *
+     * @return the new value
+     */
+    template <typename T, typename ...ArgsT>
+    inline T &emplace(ArgsT &&...args) {
+        recycle();
+        store<T>(std::forward<ArgsT>(args)...);
+        return *stor_impl<T>::data(m_data);
+    }
+
+    /**
+     * Destroy the value, leaving this any empty.
+     */
+    inline void reset() noexcept {
+        recycle();
+    }
+
+    /**
+     * Identity of a stored type: the address of the static ops table of
+     * the type, which is also kept in every any holding such a value.
+     */
+    using tag_t = const void *;
+
+    /**
+     * @return the tag of values of type T
+     */
+    template <typename T>
+    static constexpr tag_t tag_of() noexcept {
+        return &stor_table<T>::ops;
+    }
+
+    /**
+     * @return the tag of the stored type, nullptr if this any holds nothing
+     */
+    inline tag_t tag() const noexcept {
+        return m_ops;
+    }
+
+    /**
+     * Check the stored type with one compare of the tags.
+     * The type_info is only compared when the same type got another
+     * table, e.g. in another shared library.
+     *
+     * @return whether this any holds a T
+     */
+    template <typename T>
+    inline bool holds() const noexcept {
+        return m_ops == tag_of<T>() || (m_ops != nullptr && *m_ops->type == typeid(T));
+    }
+
+    /**
+     * @return whether values of T are stored in the inline buffer
+     */
+    template <typename T>
+    static constexpr bool is_inline() noexcept {
+        return stor_inline<T>::value;
+    }
+
+    /**
+     * @return whether this any holds nothing
+     */
+    inline bool empty() const noexcept {
+        return m_ops == nullptr;
+    }
+
     /**
      * @return Data type inside any, void if this any holds nothing
      */
     inline std::type_index data_type() const noexcept {
-        if (m_data.status == stor_status::null)
+        if (m_ops == nullptr)
             return typeid(void);
         else
-            return get_handler()->type();
+            return *m_ops->type;
     }
 
     /**
      * @return Convert data to text, void if this any holds nothing
      */
     inline std::string to_string() const {
-        if (m_data.status == stor_status::null)
+        if (m_ops == nullptr)
             return "mpp::any::null";
         else
-            return get_handler()->to_string();
+            return m_ops->to_string(m_data);
     }
 
+    /**
+     * @return the hash of the value, see mpp::hash(), combined with a
+     * compile-time hash of its type, so equal values of different types
+     * rarely collide; 0 if this any holds nothing
+     */
     inline std::size_t hash() const {
-        if (m_data.status == stor_status::null)
+        if (m_ops == nullptr)
             return 0;
-        return get_handler()->hash();
+        return m_ops->hash(m_data);
     }
 
     template <typename T>
     inline T &get() {
-        stor_base *ptr = get_handler();
-        if (ptr->type() != typeid(T))
-            throw_ex<mpp::runtime_error>("Access wrong type of any.");
-        return static_cast<stor_impl<T> *>(ptr)->data;
+        check_type<T>();
+        return *stor_impl<T>::data(m_data);
     }
 
     template <typename T>
     inline const T &get() const {
-        const stor_base *ptr = get_handler();
-        if (ptr->type() != typeid(T))
-            throw_ex<mpp::runtime_error>("Access wrong type of any.");
-        return static_cast<const stor_impl<T> *>(ptr)->data;
+        check_type<T>();
+        return *stor_impl<T>::data(m_data);
+    }
+
+    /**
+     * @return pointer to the value if this any holds a T, nullptr otherwise
+     */
+    template <typename T>
+    inline T *try_get() noexcept {
+        return holds<T>() ? stor_impl<T>::data(m_data) : nullptr;
+    }
+
+    template <typename T>
+    inline const T *try_get() const noexcept {
+        return holds<T>() ? stor_impl<T>::data(m_data) : nullptr;
+    }
+
+    /**
+     * Access the value without checking the type, for callers which
+     * already did, e.g. by comparing tag() with tag_of<T>().
+     * Accessing a value of another type is undefined behavior.
+     */
+    template <typename T>
+    inline T &get_unsafe() noexcept {
+        return *stor_impl<T>::data(m_data);
+    }
+
+    template <typename T>
+    inline const T &get_unsafe() const noexcept {
+        return *stor_impl<T>::data(m_data);
     }
 
     template <typename T>
@@ -481,63 +615,229 @@ public:
     }
 };
 
-class mpp::any_ref final {
-    static any::default_allocator<any> &get_allocator() {
-        static any::default_allocator<any> allocator;
-        return allocator;
+template <typename T>
+constexpr mpp::any::stor_ops mpp::any::stor_table<T>::ops;
+
+namespace mpp_impl {
+    template <typename Any, typename T>
+    using any_value_t = std::conditional_t<std::is_const<Any>::value, const T, T>;
+
+    template <typename List>
+    struct any_visit_table;
+
+    /**
+     * The tags of the listed types are compile-time constants, so the tag
+     * of the any is matched by a chain of pointer compares which the
+     * compiler can inline, visitor calls included. The type_info of the
+     * listed types, with a thunk per type calling the visitor, is only
+     * looked up when the tag is unknown, i.e. for a listed type whose
+     * table was instantiated in another shared library, or an unlisted type.
+     */
+    template <typename... Ts>
+    struct any_visit_table<mpp::typelist::list<Ts...>> {
+        template <typename T, typename R, typename Any, typename Visitor>
+        static R invoke(Any &a, Visitor &visitor) {
+            return visitor(a.template get_unsafe<any_value_t<Any, T>>());
+        }
+
+        template <typename R, typename Any, typename Visitor, typename Fallback>
+        static R match(mpp::typelist::nil, Any &a, mpp::any::tag_t, Visitor &visitor, Fallback &fallback) {
+            using thunk_t = R (*)(Any &, Visitor &);
+            // the trailing entries only keep the arrays non-empty
+            static const std::type_info *types[] = {&typeid(Ts)..., nullptr};
+            static constexpr thunk_t thunks[] = {&invoke<Ts, R, Any, Visitor>..., nullptr};
+
+            std::type_index type = a.data_type();
+            for (std::size_t i = 0; i < sizeof...(Ts); ++i) {
+                if (type == *types[i])
+                    return thunks[i](a, visitor);
+            }
+            return fallback(a);
+        }
+
+        template <typename R, typename T, typename... Rest, typename Any, typename Visitor, typename Fallback>
+        static R match(mpp::typelist::list<T, Rest...>, Any &a, mpp::any::tag_t tag,
+                       Visitor &visitor, Fallback &fallback) {
+            if (tag == mpp::any::tag_of<T>())
+                return invoke<T, R>(a, visitor);
+            return match<R>(mpp::typelist::list<Rest...>(), a, tag, visitor, fallback);
+        }
+
+        template <typename R, typename Any, typename Visitor, typename Fallback>
+        static R dispatch(Any &a, Visitor &visitor, Fallback &fallback) {
+            mpp::any::tag_t tag = a.tag();
+            if (tag == nullptr)
+                return fallback(a);
+            return match<R>(mpp::typelist::list<Ts...>(), a, tag, visitor, fallback);
+        }
+    };
+
+    template <typename List, typename Any, typename Visitor>
+    using any_visit_result_t = decltype(std::declval<Visitor &>()(
+        std::declval<any_value_t<Any, mpp::typelist::head<List>> &>()));
+
+    [[noreturn]] inline void any_visit_unlisted(const mpp::any &a) {
+        if (a.empty())
+            mpp::throw_ex<mpp::runtime_error>("Visiting null any object.");
+        mpp::throw_ex<mpp::runtime_error>("Visiting any of an unlisted type.");
+    }
+}
+
+namespace mpp {
+    /**
+     * Call the visitor with the value in the any, as a reference to the
+     * first type in the list which the any holds. The type is found by
+     * comparing the tag of the any with the tags of the listed types,
+     * without RTTI unless the tag is unknown.
+     * The visitor must return the same type for every listed type.
+     * The fallback is called with the any itself when it holds none
+     * of the listed types, or nothing.
+     *
+     * usage: mpp::visit<mpp::typelist::list<int, double>>(a, [](auto &v) { ... });
+     *
+     * @tparam List mpp::typelist::list of the types to handle
+     */
+    template <typename List, typename Any, typename Visitor, typename Fallback,
+              typename = mpp::requires_same<std::remove_const_t<Any>, any>>
+    decltype(auto) visit(Any &a, Visitor &&visitor, Fallback &&fallback) {
+        using result_t = mpp_impl::any_visit_result_t<List, Any, Visitor>;
+        return mpp_impl::any_visit_table<List>::template dispatch<result_t>(a, visitor, fallback);
+    }
+
+    /**
+     * Same as above, throwing mpp::runtime_error when the any holds none
+     * of the listed types, or nothing.
+     */
+    template <typename List, typename Any, typename Visitor,
+              typename = mpp::requires_same<std::remove_const_t<Any>, any>>
+    decltype(auto) visit(Any &a, Visitor &&visitor) {
+        using result_t = mpp_impl::any_visit_result_t<List, Any, Visitor>;
+        auto fallback = [](Any &a) -> result_t { mpp_impl::any_visit_unlisted(a); };
+        return mpp_impl::any_visit_table<List>::template dispatch<result_t>(a, visitor, fallback);
     }
+}
 
+/**
+ * A handle to an any, which either refers to an any owned elsewhere,
+ * or owns its any: inline in the handle itself, or placed in an arena.
+ * Owning handles never allocate the any on heap. An any placed in an
+ * arena is destroyed with its handle, but its memory is only reclaimed,
+ * together with the rest of the arena, when the arena is released,
+ * which must not happen before the handle is destroyed.
+ */
+class mpp::any_ref final {
     any *ptr = nullptr;
-    bool is_ref = true;
-public:
-    constexpr any_ref() = default;
+    // the arena holding *ptr, if it is owned there
+    arena_allocator *arena = nullptr;
+    // the any owned inline, ptr == &slot
+    any slot;
 
-    any_ref(const any_ref &view) : is_ref(view.is_ref) {
-        if (!is_ref)
-            ptr = get_allocator().alloc(*view.ptr);
-        else
-            ptr = view.ptr;
+    inline bool owns_inline() const noexcept {
+        return ptr == &slot;
     }
 
-    any_ref(any_ref &&view) noexcept : ptr(view.ptr), is_ref(view.is_ref) {
+    inline void place(arena_allocator &where, any &&val) {
+        ptr = ::new(where.allocate<any>()) any(std::move(val));
+        arena = &where;
+    }
+
+    inline void steal(any_ref &view) noexcept {
+        if (view.owns_inline()) {
+            slot = std::move(view.slot);
+            ptr = &slot;
+        } else {
+            ptr = view.ptr;
+            arena = view.arena;
+        }
         view.ptr = nullptr;
-        view.is_ref = true;
+        view.arena = nullptr;
     }
 
-    any_ref(any &val) : ptr(&val), is_ref(true) {}
+public:
+    any_ref() = default;
+
+    any_ref(const any_ref &view) {
+        if (view.owns_inline()) {
+            slot = view.slot;
+            ptr = &slot;
+        } else if (view.arena != nullptr) {
+            place(*view.arena, any(*view.ptr));
+        } else {
+            ptr = view.ptr;
+        }
+    }
 
-    any_ref(any val) : ptr(get_allocator().alloc(std::move(val))), is_ref(false) {}
+    any_ref(any_ref &&view) noexcept {
+        steal(view);
+    }
+
+    /**
+     * Refer to val, which must outlive the handle.
+     */
+    any_ref(any &val) : ptr(&val) {}
+
+    /**
+     * Own val, inline.
+     */
+    any_ref(any &&val) : ptr(&slot), slot(std::move(val)) {}
+
+    /**
+     * Own a copy of val, inline.
+     */
+    any_ref(const any &val) : ptr(&slot), slot(val) {}
+
+    /**
+     * Own val, placed in the arena.
+     */
+    any_ref(any &&val, arena_allocator &where) {
+        place(where, std::move(val));
+    }
+
+    any_ref(const any &val, arena_allocator &where) {
+        place(where, any(val));
+    }
 
     ~any_ref() {
-        if (is_ref)
-            get_allocator().free(ptr);
+        reset();
     }
 
     any_ref &operator=(const any_ref &view) {
-        if (&view != this) {
-            if (!is_ref)
-                get_allocator().free(ptr);
-            is_ref = view.is_ref;
-            if (!is_ref)
-                ptr = get_allocator().alloc(*view.ptr);
-            else
-                ptr = view.ptr;
-        }
+        if (&view != this)
+            *this = any_ref(view);
         return *this;
     }
 
     any_ref &operator=(any_ref &&view) noexcept {
         if (&view != this) {
-            if (!is_ref)
-                get_allocator().free(ptr);
-            is_ref = view.is_ref;
-            ptr = view.ptr;
-            view.ptr = nullptr;
-            view.is_ref = true;
+            reset();
+            steal(view);
         }
         return *this;
     }
 
+    /**
+     * Destroy the owned any, or forget the referred one.
+     */
+    inline void reset() noexcept {
+        if (owns_inline())
+            slot.reset();
+        else if (arena != nullptr)
+            ptr->~any();
+        ptr = nullptr;
+        arena = nullptr;
+    }
+
+    /**
+     * @return whether the handle refers to an any owned elsewhere
+     */
+    inline bool is_ref() const noexcept {
+        return ptr != nullptr && !owns_inline() && arena == nullptr;
+    }
+
+    inline bool empty() const noexcept {
+        return ptr == nullptr;
+    }
+
     inline any &get() const {
         if (ptr == nullptr)
             throw_ex<mpp::runtime_error>("Trying to dereference null any object.");
@@ -548,3 +848,491 @@ public:
         return get();
     }
 };
+
+/**
+ * A sequence of values of any types, stored without an mpp::any for each:
+ * the types are kept in an array of tags, one per value, and the values
+ * are packed one after another in a single aligned buffer, where they are
+ * found by their byte offsets. Consecutive values of the same type form
+ * a run, which lies in the buffer as an array of the type and is handled
+ * as a whole by the bulk operations, so their type is checked once per run.
+ *
+ * Like std::vector, the buffer grows by moving the values to a larger one,
+ * which invalidates references to them.
+ */
+class mpp::any_vector final {
+    /**
+     * Type-dependent operations, on runs of count values starting at first.
+     */
+    struct value_ops {
+        const std::type_info *type;
+        any::tag_t any_tag;
+
+        void (*destroy)(void *first, size_t count) noexcept;
+
+        // construct copies of the values at dst
+        void (*copy)(const void *first, size_t count, void *dst);
+
+        // construct the moved values at dst, or copies if moving may throw
+        void (*move)(void *first, size_t count, void *dst);
+
+        any (*to_any)(const void *);
+
+        void (*to_string)(const void *first, size_t count, std::string *);
+
+        void (*hash)(const void *first, size_t count, std::size_t *);
+    };
+
+    template <typename T>
+    struct value_table {
+        static void destroy(void *first, size_t count) noexcept {
+            for (size_t i = 0; i < count; ++i)
+                (static_cast<T *>(first) + i)->~T();
+        }
+
+        template <typename Src>
+        static void construct(Src *first, size_t count, void *dst) {
+            T *values = static_cast<T *>(dst);
+            size_t i = 0;
+            try {
+                for (; i < count; ++i)
+                    ::new(values + i) T(std::move_if_noexcept(first[i]));
+            } catch (...) {
+                destroy(values, i);
+                throw;
+            }
+        }
+
+        static void copy(const void *first, size_t count, void *dst) {
+            construct(static_cast<const T *>(first), count, dst);
+        }
+
+        static void move(void *first, size_t count, void *dst) {
+            construct(static_cast<T *>(first), count, dst);
+        }
+
+        static any to_any(const void *value) {
+            return any(*static_cast<const T *>(value));
+        }
+
+        static void to_string(const void *first, size_t count, std::string *out) {
+            for (size_t i = 0; i < count; ++i)
+                out[i] = mpp::to_string(static_cast<const T *>(first)[i]);
+        }
+
+        static void hash(const void *first, size_t count, std::size_t *out) {
+            for (size_t i = 0; i < count; ++i)
+                out[i] = mpp::hash_combine(mpp::type_hash<T>::value, mpp::hash(static_cast<const T *>(first)[i]));
+        }
+
+        static constexpr value_ops ops = {&typeid(T), any::tag_of<T>(), &destroy, &copy, &move, &to_any, &to_string,
+                                          &hash};
+    };
+
+public:
+    /**
+     * Consecutive values of the same type.
+     */
+    struct run {
+        const value_ops *ops;
+        size_t begin;
+        size_t count;
+
+        /**
+         * @return whether the values are of type T
+         */
+        template <typename T>
+        bool holds() const noexcept {
+            return ops == &value_table<T>::ops || *ops->type == typeid(T);
+        }
+
+        std::type_index data_type() const noexcept {
+            return *ops->type;
+        }
+    };
+
+private:
+    static constexpr size_t min_capacity = 256;
+
+    /**
+     * Raw memory of the values, aligned to the strictest alignment among them.
+     */
+    struct buffer {
+        void *block = nullptr;
+        unsigned char *data = nullptr;
+        size_t capacity = 0;
+        size_t alignment = alignof(std::max_align_t);
+
+        buffer() = default;
+
+        buffer(size_t size, size_t align) : capacity(size), alignment(align) {
+            if (size == 0)
+                return;
+            size_t extra = align > alignof(std::max_align_t) ? align - alignof(std::max_align_t) : 0;
+            if (size > ~size_t(0) - extra)
+                throw std::bad_alloc();
+            block = ::operator new(size + extra);
+            auto p = reinterpret_cast<std::uintptr_t>(block);
+            data = reinterpret_cast<unsigned char *>((p + align - 1) & ~std::uintptr_t(align - 1));
+        }
+
+        buffer(const buffer &) = delete;
+
+        ~buffer() {
+            ::operator delete(block);
+        }
+
+        buffer &operator=(const buffer &) = delete;
+
+        void swap(buffer &other) noexcept {
+            std::swap(block, other.block);
+            std::swap(data, other.data);
+            std::swap(capacity, other.capacity);
+            std::swap(alignment, other.alignment);
+        }
+    };
+
+    buffer m_buffer;
+    // bytes in use, up to the end of the last value
+    size_t m_used = 0;
+    std::vector<const value_ops *> m_tags;
+    std::vector<size_t> m_offsets;
+    std::vector<run> m_runs;
+
+    inline void *value(size_t index) const noexcept {
+        return m_buffer.data + m_offsets[index];
+    }
+
+    template <typename V>
+    static void reserve_one(std::vector<V> &v) {
+        if (v.size() == v.capacity())
+            v.reserve(v.size() < 8 ? 8 : v.size() * 2);
+    }
+
+    /**
+     * Record a value, with room for it reserved in the arrays.
+     */
+    inline void append(const value_ops *ops, size_t offset) noexcept {
+        m_tags.push_back(ops);
+        m_offsets.push_back(offset);
+        if (!m_runs.empty() && m_runs.back().ops == ops)
+            ++m_runs.back().count;
+        else
+            m_runs.push_back(run{ops, m_tags.size() - 1, 1});
+    }
+
+    /**
+     * Construct the values of from, moved or copied, at the same offsets
+     * from dst. If one throws, the ones constructed are destroyed.
+     */
+    static void construct_all(const any_vector &from, unsigned char *dst, bool move) {
+        size_t done = 0;
+        try {
+            for (; done < from.m_runs.size(); ++done) {
+                const run &r = from.m_runs[done];
+                void *to = dst + from.m_offsets[r.begin];
+                if (move)
+                    r.ops->move(from.value(r.begin), r.count, to);
+                else
+                    r.ops->copy(from.value(r.begin), r.count, to);
+            }
+        } catch (...) {
+            for (size_t i = 0; i < done; ++i)
+                from.m_runs[i].ops->destroy(dst + from.m_offsets[from.m_runs[i].begin], from.m_runs[i].count);
+            throw;
+        }
+    }
+
+    inline void destroy_all() noexcept {
+        for (const run &r : m_runs)
+            r.ops->destroy(value(r.begin), r.count);
+    }
+
+    /**
+     * Construct a T at offset in a larger buffer, then move the values
+     * there. The new one comes first, as args may refer to one of them.
+     */
+    template <typename T, typename ...ArgsT>
+    T *grow(size_t offset, ArgsT &&...args) {
+        if (offset > ~size_t(0) - sizeof(T))
+            throw std::bad_alloc();
+        size_t capacity = m_buffer.capacity < min_capacity / 2 ? min_capacity : m_buffer.capacity * 2;
+        if (capacity < offset + sizeof(T))
+            capacity = offset + sizeof(T);
+        buffer larger(capacity, std::max(m_buffer.alignment, alignof(T)));
+        T *value = ::new(larger.data + offset) T(std::forward<ArgsT>(args)...);
+        try {
+            construct_all(*this, larger.data, true);
+        } catch (...) {
+            value->~T();
+            throw;
+        }
+        destroy_all();
+        m_buffer.swap(larger);
+        return value;
+    }
+
+    inline void check_index(size_t index) const {
+        if (index >= m_tags.size())
+            throw_ex<mpp::runtime_error>("any_vector: invalid index");
+    }
+
+    template <typename T>
+    inline void check_type(size_t index) const {
+        check_index(index);
+        if (!holds<T>(index))
+            throw_ex<mpp::runtime_error>("Access wrong type of any.");
+    }
+
+public:
+    /**
+     * @param capacity bytes reserved for the values
+     */
+    explicit any_vector(size_t capacity = 0) : m_buffer(capacity, alignof(std::max_align_t)) {}
+
+    any_vector(const any_vector &other)
+            : m_buffer(other.m_used, other.m_buffer.alignment), m_used(other.m_used),
+              m_tags(other.m_tags), m_offsets(other.m_offsets), m_runs(other.m_runs) {
+        construct_all(other, m_buffer.data, false);
+    }
+
+    any_vector(any_vector &&other) noexcept
+            : m_used(other.m_used), m_tags(std::move(other.m_tags)),
+              m_offsets(std::move(other.m_offsets)), m_runs(std::move(other.m_runs)) {
+        m_buffer.swap(other.m_buffer);
+        other.m_used = 0;
+        other.m_tags.clear();
+        other.m_offsets.clear();
+        other.m_runs.clear();
+    }
+
+    ~any_vector() {
+        destroy_all();
+    }
+
+    any_vector &operator=(const any_vector &other) {
+        if (&other != this)
+            *this = any_vector(other);
+        return *this;
+    }
+
+    any_vector &operator=(any_vector &&other) noexcept {
+        if (&other != this) {
+            clear();
+            m_buffer.swap(other.m_buffer);
+            std::swap(m_used, other.m_used);
+            m_tags.swap(other.m_tags);
+            m_offsets.swap(other.m_offsets);
+            m_runs.swap(other.m_runs);
+        }
+        return *this;
+    }
+
+    /**
+     * Append a value, stored decayed as in mpp::any.
+     */
+    template <typename T>
+    inline void push_back(T &&val) {
+        emplace_back<std::decay_t<T>>(std::forward<T>(val));
+    }
+
+    /**
+     * Append a T constructed in place from args.
+     *
+     * @return the new value
+     */
+    template <typename T, typename ...ArgsT>
+    inline T &emplace_back(ArgsT &&...args) {
+        reserve_one(m_tags);
+        reserve_one(m_offsets);
+        reserve_one(m_runs);
+        size_t offset = (m_used + alignof(T) - 1) & ~(alignof(T) - 1);
+        T *value;
+        if (alignof(T) <= m_buffer.alignment && offset <= m_buffer.capacity
+            && sizeof(T) <= m_buffer.capacity - offset)
+            value = ::new(m_buffer.data + offset) T(std::forward<ArgsT>(args)...);
+        else
+            value = grow<T>(offset, std::forward<ArgsT>(args)...);
+        append(&value_table<T>::ops, offset);
+        m_used = offset + sizeof(T);
+        return *value;
+    }
+
+    /**
+     * Destroy the last value, its room is reused by the next one.
+     */
+    inline void pop_back() {
+        if (m_tags.empty())
+            throw_ex<mpp::runtime_error>("any_vector: pop_back() on empty vector");
+        m_tags.back()->destroy(value(m_tags.size() - 1), 1);
+        m_used = m_offsets.back();
+        m_tags.pop_back();
+        m_offsets.pop_back();
+        if (--m_runs.back().count == 0)
+            m_runs.pop_back();
+    }
+
+    /**
+     * Destroy all values, the buffer is kept for the next ones.
+     */
+    inline void clear() noexcept {
+        destroy_all();
+        m_used = 0;
+        m_tags.clear();
+        m_offsets.clear();
+        m_runs.clear();
+    }
+
+    inline size_t size() const noexcept {
+        return m_tags.size();
+    }
+
+    inline bool empty() const noexcept {
+        return m_tags.empty();
+    }
+
+    /**
+     * @return the runs of values of the same type, in order
+     */
+    inline const std::vector<run> &runs() const noexcept {
+        return m_runs;
+    }
+
+    /**
+     * @return the tag of the type of a value, the same as mpp::any::tag()
+     *         of an any holding the value
+     */
+    inline any::tag_t tag(size_t index) const {
+        check_index(index);
+        return m_tags[index]->any_tag;
+    }
+
+    inline std::type_index data_type(size_t index) const {
+        check_index(index);
+        return *m_tags[index]->type;
+    }
+
+    template <typename T>
+    inline bool holds(size_t index) const noexcept {
+        return index < m_tags.size() &&
+               (m_tags[index] == &value_table<T>::ops || *m_tags[index]->type == typeid(T));
+    }
+
+    template <typename T>
+    inline T &get(size_t index) {
+        check_type<T>(index);
+        return *static_cast<T *>(value(index));
+    }
+
+    template <typename T>
+    inline const T &get(size_t index) const {
+        check_type<T>(index);
+        return *static_cast<const T *>(value(index));
+    }
+
+    template <typename T>
+    inline T *try_get(size_t index) noexcept {
+        return holds<T>(index) ? static_cast<T *>(value(index)) : nullptr;
+    }
+
+    template <typename T>
+    inline const T *try_get(size_t index) const noexcept {
+        return holds<T>(index) ? static_cast<const T *>(value(index)) : nullptr;
+    }
+
+    template <typename T>
+    inline T &get_unsafe(size_t index) noexcept {
+        return *static_cast<T *>(value(index));
+    }
+
+    template <typename T>
+    inline const T &get_unsafe(size_t index) const noexcept {
+        return *static_cast<const T *>(value(index));
+    }
+
+    /**
+     * @return a copy of a value in an mpp::any
+     */
+    inline any at(size_t index) const {
+        check_index(index);
+        return m_tags[index]->to_any(value(index));
+    }
+
+    /**
+     * Call f(index, value) for each value of type T, checking
+     * the type once per run.
+     */
+    template <typename T, typename F>
+    void for_each(F &&f) {
+        for (const run &r : m_runs) {
+            if (r.holds<T>()) {
+                T *values = static_cast<T *>(value(r.begin));
+                for (size_t i = 0; i < r.count; ++i)
+                    f(r.begin + i, values[i]);
+            }
+        }
+    }
+
+    template <typename T, typename F>
+    void for_each(F &&f) const {
+        for (const run &r : m_runs) {
+            if (r.holds<T>()) {
+                const T *values = static_cast<const T *>(value(r.begin));
+                for (size_t i = 0; i < r.count; ++i)
+                    f(r.begin + i, values[i]);
+            }
+        }
+    }
+
+    inline std::string to_string(size_t index) const {
+        check_index(index);
+        std::string str;
+        m_tags[index]->to_string(value(index), 1, &str);
+        return str;
+    }
+
+    inline std::size_t hash(size_t index) const {
+        check_index(index);
+        std::size_t hash_value = 0;
+        m_tags[index]->hash(value(index), 1, &hash_value);
+        return hash_value;
+    }
+
+    /**
+     * Convert all values to text, one call per run.
+     *
+     * @param out array of size() strings
+     */
+    inline void to_string_all(std::string *out) const {
+        for (const run &r : m_runs)
+            r.ops->to_string(value(r.begin), r.count, out + r.begin);
+    }
+
+    /**
+     * Hash all values, one call per run.
+     *
+     * @param out array of size() hash values
+     */
+    inline void hash_all(std::size_t *out) const {
+        for (const run &r : m_runs)
+            r.ops->hash(value(r.begin), r.count, out + r.begin);
+    }
+
+    /**
+     * @return all values as text, in the form of "{a, b, c}"
+     */
+    inline std::string to_string() const {
+        std::vector<std::string> strings(size());
+        to_string_all(strings.data());
+        std::string str = "{";
+        for (size_t i = 0; i < strings.size(); ++i) {
+            if (i != 0)
+                str += ", ";
+            str += strings[i];
+        }
+        return str + "}";
+    }
+};
+
+template <typename T>
+constexpr mpp::any_vector::value_ops mpp::any_vector::value_table<T>::ops;
@@ -9,19 +9,478 @@
 #pragma once
 
 #include <mozart++/core>
+#include <atomic>
 #include <memory>
+#include <mutex>
+#include <new>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+
+#ifdef MOZART_PLATFORM_WIN32
+#include <malloc.h>
+#endif
+
+/**
+ * Size of the chunks carved into objects by mpp::slab_heap
+ */
+#ifndef MOZART_SLAB_PAGE_SIZE
+#define MOZART_SLAB_PAGE_SIZE 4096
+#endif
 
 namespace mpp {
     using std::allocator;
 
+    /**
+     * Mozart Slab Heap
+     * Small objects are rounded up to a size class, a multiple of
+     * granularity, and carved from page_size chunks holding objects of
+     * one class only, so objects of a size are packed together.
+     *
+     * Three layers serve each class:
+     * 1. Per-thread free lists, used without any locking.
+     * 2. A lock-free depot of batches shared by all threads, filled by
+     *    threads holding more than cache_limit objects and drained by
+     *    threads running out. A thread takes all batches at once and
+     *    keeps the ones it does not use yet as spare batches.
+     * 3. The chunks, under a mutex per class. Objects flushed while the
+     *    depot holds depot_limit objects go back to their chunk, and a
+     *    chunk is freed once all of its objects are back, unless it is
+     *    the only chunk of the class with room left.
+     *
+     * An object may be freed by another thread than the one allocating it.
+     * Objects larger than max_size go to ::operator new.
+     */
+    class slab_heap final {
+    public:
+        static constexpr size_t page_size = MOZART_SLAB_PAGE_SIZE;
+
+        static constexpr size_t granularity = 16;
+
+        static constexpr size_t max_size = 256;
+
+        /**
+         * Alignment of every object in the slabs
+         */
+        static constexpr size_t alignment = granularity;
+
+    private:
+        static constexpr size_t class_count = max_size / granularity;
+
+        // per thread and class
+        static constexpr size_t cache_limit = 64;
+
+        static constexpr size_t batch_size = cache_limit / 2;
+
+        // per class, counting the spare batches of all threads
+        static constexpr size_t depot_limit = 32 * batch_size;
+
+        /**
+         * A free object. The first object of a batch also links the
+         * batches in the depot. Batches end with a null next.
+         */
+        struct node {
+            node *next;
+            node *next_batch;
+        };
+
+        /**
+         * Header of a chunk, which is aligned to page_size, so the chunk
+         * of an object is found by masking its address.
+         */
+        struct chunk {
+            chunk *prev;
+            chunk *next;
+            // objects given back to the chunk
+            node *free;
+            // start of the objects never handed out
+            char *bump;
+            char *end;
+            // objects handed out and not given back
+            size_t used;
+        };
+
+        static constexpr size_t header_size = (sizeof(chunk) + granularity - 1) / granularity * granularity;
+
+        static_assert(sizeof(node) <= granularity, "granularity too small");
+        static_assert((page_size & (page_size - 1)) == 0, "MOZART_SLAB_PAGE_SIZE must be a power of two");
+        static_assert(page_size >= header_size + max_size, "MOZART_SLAB_PAGE_SIZE too small");
+
+        struct size_class {
+            std::atomic<node *> batches{nullptr};
+            std::atomic<size_t> blocks{0};
+            std::mutex lock;
+            // chunks with objects left to hand out
+            chunk *partial = nullptr;
+        };
+
+        struct central {
+            size_class classes[class_count];
+            std::atomic<size_t> page_count{0};
+        };
+
+        /**
+         * Per-thread lists. Being trivial, it stays usable while the
+         * thread exit handlers run, after the lists were handed back.
+         */
+        struct cache {
+            node *head[class_count];
+            size_t count[class_count];
+            node *spare[class_count];
+            bool registered;
+            bool dead;
+        };
+
+        struct cache_guard {
+            ~cache_guard() {
+                cache &c = get_cache();
+                for (size_t index = 0; index < class_count; ++index) {
+                    if (c.count[index] > 0)
+                        flush(c, index, c.count[index]);
+                    while (c.spare[index] != nullptr) {
+                        node *batch = c.spare[index];
+                        c.spare[index] = batch->next_batch;
+                        push_batch(index, batch);
+                    }
+                }
+                // every operation takes the slow path from now on
+                c.registered = false;
+                c.dead = true;
+            }
+        };
+
+        static central &get_central() {
+            // leaked on purpose, objects may still be freed by static destructors
+            static central *c = new central;
+            return *c;
+        }
+
+        static cache &get_cache() noexcept {
+            static thread_local cache c;
+            return c;
+        }
+
+        static constexpr size_t class_of(size_t size) noexcept {
+            return size > 0 ? (size - 1) / granularity : 0;
+        }
+
+        static constexpr size_t class_size(size_t index) noexcept {
+            return (index + 1) * granularity;
+        }
+
+        static chunk *chunk_of(node *n) noexcept {
+            return reinterpret_cast<chunk *>(reinterpret_cast<std::uintptr_t>(n) & ~std::uintptr_t(page_size - 1));
+        }
+
+        static void push_batch(size_t index, node *batch) noexcept {
+            std::atomic<node *> &batches = get_central().classes[index].batches;
+            node *head = batches.load(std::memory_order_relaxed);
+            do {
+                batch->next_batch = head;
+            } while (!batches.compare_exchange_weak(head, batch,
+                std::memory_order_release, std::memory_order_relaxed));
+        }
+
+        /**
+         * Count count more objects in the depot, unless that exceeds depot_limit.
+         */
+        static bool reserve(size_t index, size_t count) noexcept {
+            std::atomic<size_t> &blocks = get_central().classes[index].blocks;
+            size_t current = blocks.load(std::memory_order_relaxed);
+            do {
+                if (current + count > depot_limit)
+                    return false;
+            } while (!blocks.compare_exchange_weak(current, current + count, std::memory_order_relaxed));
+            return true;
+        }
+
+        static void *new_chunk() {
+            void *ptr = nullptr;
+#ifdef MOZART_PLATFORM_WIN32
+            ptr = _aligned_malloc(page_size, page_size);
+#else
+            if (::posix_memalign(&ptr, page_size, page_size) != 0)
+                ptr = nullptr;
+#endif
+            if (ptr == nullptr)
+                throw std::bad_alloc();
+            get_central().page_count.fetch_add(1, std::memory_order_relaxed);
+            return ptr;
+        }
+
+        static void delete_chunk(chunk *ch) noexcept {
+#ifdef MOZART_PLATFORM_WIN32
+            _aligned_free(ch);
+#else
+            std::free(ch);
+#endif
+            get_central().page_count.fetch_sub(1, std::memory_order_relaxed);
+        }
+
+        static void link(size_class &sc, chunk *ch) noexcept {
+            ch->prev = nullptr;
+            ch->next = sc.partial;
+            if (sc.partial != nullptr)
+                sc.partial->prev = ch;
+            sc.partial = ch;
+        }
+
+        static void unlink(size_class &sc, chunk *ch) noexcept {
+            if (ch->prev != nullptr)
+                ch->prev->next = ch->next;
+            else
+                sc.partial = ch->next;
+            if (ch->next != nullptr)
+                ch->next->prev = ch->prev;
+        }
+
+        /**
+         * Hand out up to max objects from the chunks, as a list.
+         */
+        static node *take_from_chunks(size_t index, size_t max, size_t &count) {
+            size_class &sc = get_central().classes[index];
+            size_t size = class_size(index);
+            node *list = nullptr;
+            count = 0;
+            std::lock_guard<std::mutex> guard(sc.lock);
+            while (count < max) {
+                chunk *ch = sc.partial;
+                if (ch == nullptr && count > 0)
+                    break;
+                if (ch == nullptr) {
+                    ch = static_cast<chunk *>(new_chunk());
+                    ch->free = nullptr;
+                    ch->bump = reinterpret_cast<char *>(ch) + header_size;
+                    ch->end = ch->bump + (page_size - header_size) / size * size;
+                    ch->used = 0;
+                    link(sc, ch);
+                }
+                node *n = ch->free;
+                if (n != nullptr) {
+                    ch->free = n->next;
+                } else {
+                    n = reinterpret_cast<node *>(ch->bump);
+                    ch->bump += size;
+                }
+                ++ch->used;
+                if (ch->free == nullptr && ch->bump == ch->end)
+                    unlink(sc, ch);
+                n->next = list;
+                list = n;
+                ++count;
+            }
+            return list;
+        }
+
+        /**
+         * Give a list of objects back to their chunks, freeing the
+         * chunks which have all of their objects back.
+         */
+        static void give_to_chunks(size_t index, node *list) noexcept {
+            size_class &sc = get_central().classes[index];
+            std::lock_guard<std::mutex> guard(sc.lock);
+            while (list != nullptr) {
+                node *n = list;
+                list = list->next;
+                chunk *ch = chunk_of(n);
+                if (ch->free == nullptr && ch->bump == ch->end)
+                    link(sc, ch);
+                n->next = ch->free;
+                ch->free = n;
+                // the last chunk with room is kept
+                if (--ch->used == 0 && (ch->prev != nullptr || ch->next != nullptr)) {
+                    unlink(sc, ch);
+                    delete_chunk(ch);
+                }
+            }
+        }
+
+        static void flush(cache &c, size_t index, size_t count) noexcept {
+            node *first = c.head[index], *last = first;
+            for (size_t i = 1; i < count; ++i)
+                last = last->next;
+            c.head[index] = last->next;
+            c.count[index] -= count;
+            last->next = nullptr;
+            if (reserve(index, count))
+                push_batch(index, first);
+            else
+                give_to_chunks(index, first);
+        }
+
+        /**
+         * Arrange for the lists to be handed back when the thread exits.
+         */
+        static void register_cache(cache &c) {
+            c.registered = true;
+            static thread_local cache_guard guard;
+            (void) guard;
+        }
+
+        static void *refill(cache &c, size_t index) {
+            if (!c.registered && !c.dead)
+                register_cache(c);
+            size_t count = 0;
+            if (c.dead) {
+                // the thread is exiting, keep nothing
+                return take_from_chunks(index, 1, count);
+            }
+            if (c.spare[index] == nullptr) {
+                std::atomic<node *> &batches = get_central().classes[index].batches;
+                if (batches.load(std::memory_order_relaxed) != nullptr)
+                    c.spare[index] = batches.exchange(nullptr, std::memory_order_acquire);
+            }
+            node *list = c.spare[index];
+            if (list != nullptr) {
+                c.spare[index] = list->next_batch;
+                for (node *n = list; n != nullptr; n = n->next)
+                    ++count;
+                get_central().classes[index].blocks.fetch_sub(count, std::memory_order_relaxed);
+            } else {
+                list = take_from_chunks(index, batch_size, count);
+            }
+            c.head[index] = list->next;
+            c.count[index] = count - 1;
+            return list;
+        }
+
+        static void give_back(cache &c, size_t index, node *n) noexcept {
+            if (!c.registered && !c.dead)
+                register_cache(c);
+            if (c.dead) {
+                n->next = nullptr;
+                give_to_chunks(index, n);
+                return;
+            }
+            n->next = c.head[index];
+            c.head[index] = n;
+            if (++c.count[index] > cache_limit)
+                flush(c, index, batch_size);
+        }
+
+    public:
+        /**
+         * @param size: Size of the object in bytes
+         * @return Pointer to allocated memory space, aligned to alignment
+         * if size is not larger than max_size
+         */
+        static void *allocate(size_t size) {
+            if (size > max_size)
+                return ::operator new(size);
+            size_t index = class_of(size);
+            cache &c = get_cache();
+            node *n = c.head[index];
+            if (n == nullptr)
+                return refill(c, index);
+            c.head[index] = n->next;
+            --c.count[index];
+            return n;
+        }
+
+        /**
+         * @param ptr: Pointer returned by allocate()
+         * @param size: The same size as given to allocate()
+         */
+        static void deallocate(void *ptr, size_t size) noexcept {
+            if (ptr == nullptr)
+                return;
+            if (size > max_size) {
+                ::operator delete(ptr);
+                return;
+            }
+            size_t index = class_of(size);
+            cache &c = get_cache();
+            node *n = static_cast<node *>(ptr);
+            if (!c.registered || c.count[index] >= cache_limit) {
+                give_back(c, index, n);
+                return;
+            }
+            n->next = c.head[index];
+            c.head[index] = n;
+            ++c.count[index];
+        }
+
+        /**
+         * @return Number of chunks currently allocated by all threads
+         */
+        static size_t page_count() noexcept {
+            return get_central().page_count.load(std::memory_order_relaxed);
+        }
+    };
+
+    /**
+     * Standard Allocator Implementation on top of slab_heap, usable as
+     * allocator_t of the allocators below and of standard containers.
+     * Arrays too large for a size class and types aligned beyond
+     * slab_heap::alignment are passed on to ::operator new, the aligned
+     * one where needed. Without C++17 aligned new, types aligned beyond
+     * std::max_align_t are rejected.
+     * @tparam T: Target Allocation Type
+     */
+    template <typename T>
+    class slab_allocator {
+#ifndef __cpp_aligned_new
+        static_assert(alignof(T) <= alignof(std::max_align_t),
+                      "over-aligned types need aligned operator new (C++17)");
+#endif
+
+        static constexpr bool in_slab = alignof(T) <= slab_heap::alignment;
+
+    public:
+        using value_type = T;
+
+        slab_allocator() noexcept = default;
+
+        template <typename U>
+        slab_allocator(const slab_allocator<U> &) noexcept {}
+
+        T *allocate(size_t count) {
+            if (count > size_t(-1) / sizeof(T))
+                throw std::bad_alloc();
+            if (in_slab)
+                return static_cast<T *>(slab_heap::allocate(count * sizeof(T)));
+#ifdef __cpp_aligned_new
+            if (alignof(T) > alignof(std::max_align_t))
+                return static_cast<T *>(::operator new(count * sizeof(T), std::align_val_t(alignof(T))));
+#endif
+            return static_cast<T *>(::operator new(count * sizeof(T)));
+        }
+
+        void deallocate(T *ptr, size_t count) noexcept {
+            if (in_slab) {
+                slab_heap::deallocate(ptr, count * sizeof(T));
+                return;
+            }
+#ifdef __cpp_aligned_new
+            if (alignof(T) > alignof(std::max_align_t)) {
+                ::operator delete(ptr, std::align_val_t(alignof(T)));
+                return;
+            }
+#endif
+            ::operator delete(ptr);
+        }
+
+        template <typename U>
+        bool operator==(const slab_allocator<U> &) const noexcept {
+            return true;
+        }
+
+        template <typename U>
+        bool operator!=(const slab_allocator<U> &) const noexcept {
+            return false;
+        }
+    };
+
     /**
      * Mozart Allocator Generic Type
      * @tparam T: Target Allocation Type
      * @tparam blck_size: Allocation Chunk Size
-     * @tparam allocator_t: Standard Allocator Implementation
+     * @tparam allocator_t: Standard Allocator Implementation, slab_allocator by default
      */
-    template <typename T, size_t blck_size, template <typename> class allocator_t = allocator>
+    template <typename T, size_t blck_size, template <typename> class allocator_t = slab_allocator>
     class plain_allocator_type final {
+        using traits = std::allocator_traits<allocator_t<T>>;
+
         allocator_t<T> mAlloc;
 
     public:
@@ -51,7 +510,7 @@ namespace mpp {
         template <typename... ArgsT>
         inline T *alloc(ArgsT &&... args) {
             T *ptr = mAlloc.allocate(1);
-            mAlloc.construct(ptr, forward<ArgsT>(args)...);
+            traits::construct(mAlloc, ptr, std::forward<ArgsT>(args)...);
             return ptr;
         }
 
@@ -60,7 +519,7 @@ namespace mpp {
          * @param ptr: Pointer to allocated memory space
          */
         inline void free(T *ptr) {
-            mAlloc.destroy(ptr);
+            traits::destroy(mAlloc, ptr);
             mAlloc.deallocate(ptr, 1);
         }
     };
@@ -70,10 +529,12 @@ namespace mpp {
      * Following Mozart Allocator Generic Type
      * @tparam T: Target Allocation Type
      * @tparam blck_size: Balancing Cache Size
-     * @tparam allocator_t: Standard Allocator Implementation
+     * @tparam allocator_t: Standard Allocator Implementation, slab_allocator by default
      */
-    template <typename T, size_t blck_size, template <typename> class allocator_t = allocator>
+    template <typename T, size_t blck_size, template <typename> class allocator_t = slab_allocator>
     class allocator_type final {
+        using traits = std::allocator_traits<allocator_t<T>>;
+
         T *mPool[blck_size];
         allocator_t<T> mAlloc;
         size_t mOffset = 0;
@@ -100,16 +561,162 @@ namespace mpp {
                 ptr = mPool[--mOffset];
             else
                 ptr = mAlloc.allocate(1);
-            mAlloc.construct(ptr, std::forward<ArgsT>(args)...);
+            traits::construct(mAlloc, ptr, std::forward<ArgsT>(args)...);
             return ptr;
         }
 
         inline void free(T *ptr) {
-            mAlloc.destroy(ptr);
+            traits::destroy(mAlloc, ptr);
             if (mOffset < blck_size)
                 mPool[mOffset++] = ptr;
             else
                 mAlloc.deallocate(ptr, 1);
         }
     };
+
+    /**
+     * Mozart Arena Allocator
+     * Hands out memory by bumping a pointer through large chunks,
+     * which are only returned all at once by release() or the destructor.
+     * No destructor is ever called for the objects placed in the arena.
+     * Satisfies the Allocator hook of string_ref::copy().
+     */
+    class arena_allocator final {
+        struct chunk {
+            chunk *next;
+        };
+
+        static constexpr size_t header_size =
+                (sizeof(chunk) + alignof(std::max_align_t) - 1) & ~(alignof(std::max_align_t) - 1);
+
+        static constexpr size_t max_chunk_size = 1u << 20;
+
+        chunk *mChunks = nullptr;
+        byte_t *mCursor = nullptr;
+        byte_t *mLimit = nullptr;
+        size_t mChunkSize;
+        size_t mAllocated = 0;
+
+        static std::uintptr_t align_up(std::uintptr_t p, size_t align) {
+            return (p + align - 1) & ~std::uintptr_t(align - 1);
+        }
+
+        byte_t *new_chunk(size_t size, bool dedicated) {
+            if (size > ~size_t(0) - header_size) {
+                throw std::bad_alloc();
+            }
+            auto *c = static_cast<chunk *>(::operator new(header_size + size));
+            mAllocated += header_size + size;
+            // dedicated chunks are linked behind the current one so that
+            // the space left in the current chunk stays usable
+            if (dedicated && mChunks != nullptr) {
+                c->next = mChunks->next;
+                mChunks->next = c;
+            } else {
+                c->next = mChunks;
+                mChunks = c;
+            }
+            return reinterpret_cast<byte_t *>(c) + header_size;
+        }
+
+        void *allocate_slow(size_t size, size_t align) {
+            // large blocks get a chunk of their own
+            if (align >= mChunkSize / 4 || size > mChunkSize / 4 - align) {
+                if (size > ~size_t(0) - align) {
+                    throw std::bad_alloc();
+                }
+                byte_t *block = new_chunk(size + align - 1, true);
+                return reinterpret_cast<void *>(align_up(reinterpret_cast<std::uintptr_t>(block), align));
+            }
+            mCursor = new_chunk(mChunkSize, false);
+            mLimit = mCursor + mChunkSize;
+            if (mChunkSize < max_chunk_size) {
+                mChunkSize *= 2;
+            }
+            return allocate_bytes(size, align);
+        }
+
+    public:
+        explicit arena_allocator(size_t chunk_size = 4096)
+                : mChunkSize(chunk_size < 256 ? 256 : chunk_size) {}
+
+        arena_allocator(const arena_allocator &) = delete;
+
+        arena_allocator(arena_allocator &&other) noexcept
+                : mChunks(other.mChunks), mCursor(other.mCursor), mLimit(other.mLimit),
+                  mChunkSize(other.mChunkSize), mAllocated(other.mAllocated) {
+            other.mChunks = nullptr;
+            other.mCursor = other.mLimit = nullptr;
+            other.mAllocated = 0;
+        }
+
+        arena_allocator &operator=(const arena_allocator &) = delete;
+
+        arena_allocator &operator=(arena_allocator &&other) noexcept {
+            if (this != &other) {
+                release();
+                swap(mChunks, other.mChunks);
+                swap(mCursor, other.mCursor);
+                swap(mLimit, other.mLimit);
+                swap(mChunkSize, other.mChunkSize);
+                swap(mAllocated, other.mAllocated);
+            }
+            return *this;
+        }
+
+        ~arena_allocator() {
+            release();
+        }
+
+        /**
+         * Allocate raw memory, aligned to align (a power of two).
+         * @param size: Size in bytes
+         * @param align: Alignment in bytes
+         * @return Pointer to allocated memory space
+         */
+        void *allocate_bytes(size_t size, size_t align = alignof(std::max_align_t)) {
+            auto cursor = reinterpret_cast<std::uintptr_t>(mCursor);
+            auto limit = reinterpret_cast<std::uintptr_t>(mLimit);
+            auto p = align_up(cursor, align);
+            if (mCursor != nullptr && p <= limit && size <= limit - p) {
+                mCursor = reinterpret_cast<byte_t *>(p + size);
+                return reinterpret_cast<void *>(p);
+            }
+            return allocate_slow(size, align);
+        }
+
+        /**
+         * [inlined] Allocate uninitialized storage for count objects of T
+         * @tparam T: Target Allocation Type
+         * @param count: Number of objects
+         * @return Pointer to allocated memory space
+         */
+        template <typename T>
+        inline T *allocate(size_t count = 1) {
+            if (count > ~size_t(0) / sizeof(T)) {
+                throw std::bad_alloc();
+            }
+            return static_cast<T *>(allocate_bytes(sizeof(T) * count, alignof(T)));
+        }
+
+        /**
+         * Free every chunk. Everything allocated before becomes invalid.
+         */
+        void release() {
+            while (mChunks != nullptr) {
+                chunk *next = mChunks->next;
+                ::operator delete(mChunks);
+                mChunks = next;
+            }
+            mCursor = mLimit = nullptr;
+            mAllocated = 0;
+        }
+
+        /**
+         * Total bytes requested from the system so far.
+         */
+        size_t allocated_bytes() const {
+            return mAllocated;
+        }
+    };
 }
@@ -13,14 +13,1032 @@
 #include <mozart++/string>
 #include <mozart++/iterator_range>
 #include <iomanip>
-#include <regex>
+#include <locale>
 #include <sstream>
 #include <string>
+#include <vector>
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
 
 namespace mpp_impl {
-    using string_iter_t = mpp::string_ref::const_iterator;
-    using match_t = std::match_results<string_iter_t>;
+    /*
+     * Number conversions of the formatter, which produce exactly
+     * the same text as std::num_put does in the classic locale.
+     */
 
+    constexpr char digit_pairs[] =
+        "00010203040506070809"
+        "10111213141516171819"
+        "20212223242526272829"
+        "30313233343536373839"
+        "40414243444546474849"
+        "50515253545556575859"
+        "60616263646566676869"
+        "70717273747576777879"
+        "80818283848586878889"
+        "90919293949596979899";
+
+    constexpr char hex_digits[] = "0123456789abcdef";
+
+    /**
+     * Write the decimal digits of value backwards, ending at end.
+     *
+     * @return the first digit
+     */
+    inline char *write_decimal_backward(char *end, std::uint64_t value) {
+        while (value >= 100) {
+            const char *pair = digit_pairs + (value % 100) * 2;
+            value /= 100;
+            *--end = pair[1];
+            *--end = pair[0];
+        }
+        if (value >= 10) {
+            const char *pair = digit_pairs + value * 2;
+            *--end = pair[1];
+            *--end = pair[0];
+        } else {
+            *--end = static_cast<char>('0' + value);
+        }
+        return end;
+    }
+
+    /**
+     * Write the digits of value in base 8 or 16 backwards, ending at end.
+     *
+     * @return the first digit
+     */
+    inline char *write_power2_backward(char *end, std::uint64_t value, unsigned bits) {
+        std::uint64_t mask = (std::uint64_t(1) << bits) - 1;
+        do {
+            *--end = hex_digits[value & mask];
+            value >>= bits;
+        } while (value != 0);
+        return end;
+    }
+
+    /**
+     * Unsigned integer with just enough bits to hold
+     * the exact value of a double, integer or fraction part.
+     */
+    class exact_bigint {
+        static constexpr size_t max_limbs = 40;
+
+        std::uint32_t _limbs[max_limbs];
+        size_t _size = 0;
+
+        void trim() {
+            while (_size > 0 && _limbs[_size - 1] == 0) {
+                --_size;
+            }
+        }
+
+    public:
+        /**
+         * Assign value << shift.
+         */
+        void assign(std::uint64_t value, unsigned shift) {
+            size_t words = shift / 32;
+            unsigned bits = shift % 32;
+            std::uint64_t low = value << bits;
+            std::uint64_t high = bits == 0 ? 0 : value >> (64 - bits);
+            for (size_t i = 0; i < words; ++i) {
+                _limbs[i] = 0;
+            }
+            _limbs[words] = static_cast<std::uint32_t>(low);
+            _limbs[words + 1] = static_cast<std::uint32_t>(low >> 32);
+            _limbs[words + 2] = static_cast<std::uint32_t>(high);
+            _size = words + 3;
+            trim();
+        }
+
+        bool is_zero() const {
+            return _size == 0;
+        }
+
+        /**
+         * Divide by divisor in place.
+         *
+         * @return the remainder
+         */
+        std::uint32_t divide(std::uint32_t divisor) {
+            std::uint64_t rem = 0;
+            for (size_t i = _size; i-- > 0;) {
+                std::uint64_t cur = (rem << 32) | _limbs[i];
+                _limbs[i] = static_cast<std::uint32_t>(cur / divisor);
+                rem = cur % divisor;
+            }
+            trim();
+            return static_cast<std::uint32_t>(rem);
+        }
+
+        /**
+         * Multiply by 10, then take away and return the bits above the
+         * lowest bits, which is the next decimal digit of a fraction.
+         */
+        unsigned next_digit(unsigned bits) {
+            std::uint64_t carry = 0;
+            for (size_t i = 0; i < _size; ++i) {
+                std::uint64_t cur = std::uint64_t(_limbs[i]) * 10 + carry;
+                _limbs[i] = static_cast<std::uint32_t>(cur);
+                carry = cur >> 32;
+            }
+            if (carry != 0) {
+                _limbs[_size++] = static_cast<std::uint32_t>(carry);
+            }
+
+            size_t word = bits / 32;
+            unsigned shift = bits % 32;
+            std::uint64_t window = 0;
+            if (word < _size) {
+                window = _limbs[word];
+            }
+            if (word + 1 < _size) {
+                window |= std::uint64_t(_limbs[word + 1]) << 32;
+            }
+            unsigned digit = static_cast<unsigned>(window >> shift);
+            if (word < _size) {
+                _limbs[word] &= static_cast<std::uint32_t>((std::uint64_t(1) << shift) - 1);
+                _size = word + 1;
+                trim();
+            }
+            return digit;
+        }
+    };
+
+    /**
+     * Exact decimal expansion of a non-negative m * 2^e,
+     * whose fraction digits are generated on demand.
+     */
+    class decimal_expansion {
+        // the longest integer part of a double has 309 digits
+        char _int_digits[320];
+        size_t _int_size = 0;
+
+        // fraction is _frac / 2^_frac_bits
+        unsigned _frac_bits = 0;
+        bool _small = true;
+        std::uint64_t _frac_small = 0;
+        exact_bigint _frac_big;
+
+        void assign_integer(exact_bigint &n) {
+            // 1e9 chunks, least significant first
+            std::uint32_t chunks[40];
+            size_t count = 0;
+            while (!n.is_zero()) {
+                chunks[count++] = n.divide(1000000000);
+            }
+            char *p = _int_digits;
+            for (size_t i = count; i-- > 0;) {
+                char buf[16];
+                char *end = buf + sizeof(buf);
+                char *begin = write_decimal_backward(end, chunks[i]);
+                if (i + 1 != count) {
+                    // inner chunks have leading zeros
+                    while (end - begin < 9) {
+                        *--begin = '0';
+                    }
+                }
+                std::memcpy(p, begin, end - begin);
+                p += end - begin;
+            }
+            _int_size = p - _int_digits;
+        }
+
+        void assign_integer(std::uint64_t value) {
+            if (value == 0) {
+                _int_size = 0;
+                return;
+            }
+            char buf[24];
+            char *end = buf + sizeof(buf);
+            char *begin = write_decimal_backward(end, value);
+            _int_size = end - begin;
+            std::memcpy(_int_digits, begin, _int_size);
+        }
+
+    public:
+        decimal_expansion(std::uint64_t m, int e) {
+            if (e >= 0) {
+                if (e < 11) {
+                    assign_integer(m << e);
+                } else {
+                    exact_bigint n;
+                    n.assign(m, static_cast<unsigned>(e));
+                    assign_integer(n);
+                }
+                return;
+            }
+
+            _frac_bits = static_cast<unsigned>(-e);
+            std::uint64_t frac = m;
+            if (_frac_bits < 64) {
+                assign_integer(m >> _frac_bits);
+                frac = m & ((std::uint64_t(1) << _frac_bits) - 1);
+            }
+            // multiplying by 10 must not overflow
+            _small = _frac_bits <= 60;
+            if (_small) {
+                _frac_small = frac;
+            } else {
+                _frac_big.assign(frac, 0);
+            }
+        }
+
+        const char *int_digits() const {
+            return _int_digits;
+        }
+
+        size_t int_size() const {
+            return _int_size;
+        }
+
+        bool fraction_zero() const {
+            return _small ? _frac_small == 0 : _frac_big.is_zero();
+        }
+
+        char next_fraction_digit() {
+            if (_small) {
+                _frac_small *= 10;
+                unsigned digit = static_cast<unsigned>(_frac_small >> _frac_bits);
+                _frac_small &= (std::uint64_t(1) << _frac_bits) - 1;
+                return static_cast<char>('0' + digit);
+            }
+            return static_cast<char>('0' + _frac_big.next_digit(_frac_bits));
+        }
+    };
+
+    /**
+     * Text of a formatted floating point, in pieces:
+     * body, then zeros, then tail (the exponent).
+     */
+    struct float_chars {
+        // sign, 309 integer digits, point and 1074 fraction digits at most
+        char body[1400];
+        size_t body_size = 0;
+        size_t zeros = 0;
+        char tail[8];
+        size_t tail_size = 0;
+
+        size_t size() const {
+            return body_size + zeros + tail_size;
+        }
+
+        void push(char c) {
+            body[body_size++] = c;
+        }
+
+        void push(const char *str, size_t length) {
+            std::memcpy(body + body_size, str, length);
+            body_size += length;
+        }
+
+        void exponent(char e, int exp, int min_digits = 2) {
+            tail[tail_size++] = e;
+            tail[tail_size++] = exp < 0 ? '-' : '+';
+            unsigned u = exp < 0 ? -exp : exp;
+            char buf[8];
+            char *end = buf + sizeof(buf);
+            char *begin = write_decimal_backward(end, u);
+            while (end - begin < min_digits) {
+                *--begin = '0';
+            }
+            std::memcpy(tail + tail_size, begin, end - begin);
+            tail_size += end - begin;
+        }
+    };
+
+    /**
+     * Round the digits up if the rest of digits (the first one is next,
+     * and sticky tells if there are more non-zeros) is more than half,
+     * or exactly half with the last digit odd.
+     *
+     * @return true if carried out of the first digit, the digits are all zeros then
+     */
+    inline bool round_digits(char *digits, size_t size, char next, bool sticky) {
+        if (next < '5') {
+            return false;
+        }
+        if (next == '5' && !sticky && (size == 0 || (digits[size - 1] - '0') % 2 == 0)) {
+            return false;
+        }
+        for (size_t i = size; i-- > 0;) {
+            if (digits[i] != '9') {
+                ++digits[i];
+                return false;
+            }
+            digits[i] = '0';
+        }
+        return true;
+    }
+
+    /**
+     * Significant digits of a double, rounded.
+     */
+    struct significant_digits {
+        char digits[800];
+        // digits stored, the rest up to the precision are zeros
+        size_t size = 0;
+        // decimal exponent of the first digit
+        int exp = 0;
+
+        /**
+         * @param x the expansion
+         * @param count number of significant digits wanted
+         */
+        significant_digits(decimal_expansion &x, size_t count) {
+            const char *ints = x.int_digits();
+            size_t int_size = x.int_size();
+            char next = '0';
+            bool sticky = false;
+
+            if (int_size > count) {
+                // rounded in the integer part
+                exp = static_cast<int>(int_size) - 1;
+                size = count;
+                std::memcpy(digits, ints, size);
+                next = ints[count];
+                for (size_t i = count + 1; i < int_size && !sticky; ++i) {
+                    sticky = ints[i] != '0';
+                }
+                sticky = sticky || !x.fraction_zero();
+            } else {
+                if (int_size > 0) {
+                    exp = static_cast<int>(int_size) - 1;
+                    size = int_size;
+                    std::memcpy(digits, ints, size);
+                } else if (!x.fraction_zero()) {
+                    // skip the leading zeros of fraction
+                    char d = x.next_fraction_digit();
+                    exp = -1;
+                    while (d == '0') {
+                        d = x.next_fraction_digit();
+                        --exp;
+                    }
+                    digits[size++] = d;
+                } else {
+                    // zero
+                    digits[size++] = '0';
+                    return;
+                }
+                while (size < count && size < sizeof(digits) && !x.fraction_zero()) {
+                    digits[size++] = x.next_fraction_digit();
+                }
+                if (size == count && !x.fraction_zero()) {
+                    next = x.next_fraction_digit();
+                    sticky = !x.fraction_zero();
+                }
+            }
+
+            if (round_digits(digits, size, next, sticky)) {
+                digits[0] = '1';
+                ++exp;
+            }
+        }
+    };
+
+    /**
+     * printf("%.*f")
+     */
+    inline void format_fixed(float_chars &out, decimal_expansion &x, size_t precision) {
+        char *digits = out.body + out.body_size;
+        size_t int_size = x.int_size();
+        size_t size = 0;
+        if (int_size == 0) {
+            digits[size++] = '0';
+        } else {
+            std::memcpy(digits, x.int_digits(), int_size);
+            size = int_size;
+        }
+        size_t int_end = size;
+
+        size_t frac_size = 0;
+        while (frac_size < precision && !x.fraction_zero()) {
+            digits[size++] = x.next_fraction_digit();
+            ++frac_size;
+        }
+        if (frac_size == precision && !x.fraction_zero()) {
+            char next = x.next_fraction_digit();
+            if (round_digits(digits, size, next, !x.fraction_zero())) {
+                std::memmove(digits + 1, digits, size++);
+                digits[0] = '1';
+                ++int_end;
+            }
+        }
+
+        out.body_size += int_end;
+        if (precision > 0) {
+            // insert the point
+            std::memmove(digits + int_end + 1, digits + int_end, size - int_end);
+            digits[int_end] = '.';
+            out.body_size += size - int_end + 1;
+            out.zeros = precision - frac_size;
+        }
+    }
+
+    /**
+     * printf("%.*e")
+     */
+    inline void format_scientific(float_chars &out, decimal_expansion &x, size_t precision, bool strip) {
+        significant_digits sig(x, precision + 1);
+        out.push(sig.digits[0]);
+        size_t size = sig.size;
+        size_t zeros = precision + 1 - std::min(precision + 1, size);
+        if (strip) {
+            while (size > 1 && sig.digits[size - 1] == '0') {
+                --size;
+            }
+            zeros = 0;
+        }
+        if (size > 1 || zeros > 0) {
+            out.push('.');
+            out.push(sig.digits + 1, size - 1);
+            out.zeros = zeros;
+        }
+        out.exponent('e', sig.exp);
+    }
+
+    /**
+     * printf("%.*g")
+     */
+    inline void format_general(float_chars &out, decimal_expansion &x, size_t precision) {
+        size_t p = precision == 0 ? 1 : precision;
+        significant_digits sig(x, p);
+        int exp = sig.exp;
+        if (exp < -4 || exp >= static_cast<int>(p)) {
+            // the same rounding as the scientific format
+            size_t size = sig.size;
+            while (size > 1 && sig.digits[size - 1] == '0') {
+                --size;
+            }
+            out.push(sig.digits[0]);
+            if (size > 1) {
+                out.push('.');
+                out.push(sig.digits + 1, size - 1);
+            }
+            out.exponent('e', exp);
+            return;
+        }
+
+        size_t size = sig.size;
+        while (size > static_cast<size_t>(std::max(exp + 1, 0)) && size > 0 && sig.digits[size - 1] == '0') {
+            --size;
+        }
+        if (exp >= 0) {
+            size_t int_size = exp + 1;
+            // integer digits are always stored, see significant_digits
+            out.push(sig.digits, int_size);
+            if (size > int_size) {
+                out.push('.');
+                out.push(sig.digits + int_size, size - int_size);
+            }
+        } else {
+            out.push('0');
+            if (size > 0) {
+                out.push('.');
+                for (int i = exp + 1; i < 0; ++i) {
+                    out.push('0');
+                }
+                out.push(sig.digits, size);
+            }
+        }
+    }
+
+    /**
+     * printf("%a")
+     */
+    inline void format_hexfloat(float_chars &out, std::uint64_t bits) {
+        std::uint64_t mantissa = bits & ((std::uint64_t(1) << 52) - 1);
+        int biased = static_cast<int>((bits >> 52) & 0x7ff);
+        out.push("0x", 2);
+        if (biased == 0 && mantissa == 0) {
+            out.push('0');
+            out.exponent('p', 0, 1);
+            return;
+        }
+        out.push(biased == 0 ? '0' : '1');
+        if (mantissa != 0) {
+            char buf[13];
+            for (int i = 12; i >= 0; --i) {
+                buf[i] = hex_digits[mantissa & 0xf];
+                mantissa >>= 4;
+            }
+            size_t size = 13;
+            while (buf[size - 1] == '0') {
+                --size;
+            }
+            out.push('.');
+            out.push(buf, size);
+        }
+        out.exponent('p', biased == 0 ? -1022 : biased - 1023, 1);
+    }
+
+    enum class float_style {
+        general, fixed, scientific, hex
+    };
+
+    /**
+     * Format a double like printf does with the conversion of style.
+     */
+    inline void format_double(float_chars &out, double value, float_style style, size_t precision) {
+        std::uint64_t bits = 0;
+        std::memcpy(&bits, &value, sizeof(bits));
+        if (bits >> 63) {
+            out.push('-');
+        }
+
+        int biased = static_cast<int>((bits >> 52) & 0x7ff);
+        std::uint64_t mantissa = bits & ((std::uint64_t(1) << 52) - 1);
+        if (biased == 0x7ff) {
+            out.push(mantissa == 0 ? "inf" : "nan", 3);
+            return;
+        }
+        if (style == float_style::hex) {
+            format_hexfloat(out, bits);
+            return;
+        }
+
+        // value = m * 2^e
+        std::uint64_t m = biased == 0 ? mantissa : mantissa | (std::uint64_t(1) << 52);
+        int e = biased == 0 ? -1074 : biased - 1075;
+        if (m == 0) {
+            e = 0;
+        }
+        decimal_expansion x(m, e);
+        switch (style) {
+            case float_style::fixed:
+                format_fixed(out, x, precision);
+                break;
+            case float_style::scientific:
+                format_scientific(out, x, precision, false);
+                break;
+            default:
+                format_general(out, x, precision);
+                break;
+        }
+    }
+}
+
+namespace mpp {
+    /**
+     * A character sink for the formatter, which writes values directly
+     * without any std::ostream involved.
+     * Characters are stored inline until the inline storage is full,
+     * then the buffer grows on heap. Alternatively, the buffer can wrap
+     * a caller-supplied array, in which case it never grows and the
+     * characters that do not fit are dropped (but still counted).
+     *
+     * The buffer keeps the same formatting state as std::ios does
+     * (width, fill, precision and flags) so the output is exactly
+     * the same as formatting to a std::stringstream.
+     *
+     * A buffer bound to the std::ostream it formats for hands values
+     * of user types over to that stream, see bind().
+     */
+    class char_buffer final {
+    public:
+        static constexpr size_t inline_capacity = 256;
+
+        /**
+         * Subset of std::ios::fmtflags used by the formatter.
+         */
+        struct fmtflags {
+            bool left = false;
+            bool showbase = false;
+            bool fixed = false;
+            bool scientific = false;
+            int base = 10;
+        };
+
+    private:
+        char *_data = _inline;
+        size_t _size = 0;
+        size_t _capacity = inline_capacity;
+        // characters dropped by a non-growable buffer
+        size_t _dropped = 0;
+        bool _growable = true;
+        std::ostream *_stream = nullptr;
+
+        fmtflags _flags;
+        int _width = 0;
+        int _precision = 6;
+        char _fill = ' ';
+
+        char _inline[inline_capacity];
+
+        void grow(size_t required) {
+            size_t capacity = _capacity * 2;
+            while (capacity < required) {
+                capacity *= 2;
+            }
+            char *data = new char[capacity];
+            std::memcpy(data, _data, _size);
+            if (_data != _inline) {
+                delete[] _data;
+            }
+            _data = data;
+            _capacity = capacity;
+        }
+
+        /**
+         * Write the text, padded to the width with fill chars.
+         * The width is reset after every write, like std::ostream does.
+         */
+        void write_padded(const char *str, size_t length) {
+            size_t width = _width > 0 ? static_cast<size_t>(_width) : 0;
+            _width = 0;
+            if (width <= length) {
+                append(str, length);
+            } else if (_flags.left) {
+                append(str, length);
+                append(width - length, _fill);
+            } else {
+                append(width - length, _fill);
+                append(str, length);
+            }
+        }
+
+        template <typename T>
+        void write_integer(T value) {
+            using unsigned_t = std::make_unsigned_t<T>;
+
+            // enough for 64-bit octals and prefixes
+            char buf[32];
+            char *end = buf + sizeof(buf);
+            char *p = nullptr;
+
+            // like std::ostream, only decimals have signs
+            bool negative = _flags.base == 10 && value < 0;
+            // negated in unsigned_t, narrow types are promoted to int on the way
+            unsigned_t u = negative ? unsigned_t(0) - static_cast<unsigned_t>(value)
+                                    : static_cast<unsigned_t>(value);
+            switch (_flags.base) {
+                case 16:
+                    p = mpp_impl::write_power2_backward(end, u, 4);
+                    break;
+                case 8:
+                    p = mpp_impl::write_power2_backward(end, u, 3);
+                    break;
+                default:
+                    p = mpp_impl::write_decimal_backward(end, u);
+                    break;
+            }
+
+            if (_flags.showbase && value != 0) {
+                if (_flags.base == 16) {
+                    *--p = 'x';
+                    *--p = '0';
+                } else if (_flags.base == 8) {
+                    *--p = '0';
+                }
+            }
+            if (negative) {
+                *--p = '-';
+            }
+            write_padded(p, end - p);
+        }
+
+        void write_floating(double value) {
+            using mpp_impl::float_style;
+            float_style style = _flags.fixed && _flags.scientific ? float_style::hex
+                                : _flags.fixed ? float_style::fixed
+                                : _flags.scientific ? float_style::scientific
+                                : float_style::general;
+            mpp_impl::float_chars chars;
+            mpp_impl::format_double(chars, value, style, _precision > 0 ? _precision : 0);
+
+            size_t width = _width > 0 ? static_cast<size_t>(_width) : 0;
+            size_t length = chars.size();
+            if (width > length && !_flags.left) {
+                append(width - length, _fill);
+            }
+            append(chars.body, chars.body_size);
+            append(chars.zeros, '0');
+            append(chars.tail, chars.tail_size);
+            if (width > length && _flags.left) {
+                append(width - length, _fill);
+            }
+            _width = 0;
+        }
+
+        void write_floating(long double value) {
+            // long double is left to printf, as std::num_put does
+            char conv[8];
+            char *c = conv;
+            *c++ = '%';
+            bool hexfloat = _flags.fixed && _flags.scientific;
+            if (!hexfloat) {
+                *c++ = '.';
+                *c++ = '*';
+            }
+            *c++ = 'L';
+            *c++ = hexfloat ? 'a' : _flags.fixed ? 'f' : _flags.scientific ? 'e' : 'g';
+            *c = '\0';
+
+            char buf[64];
+            int length = hexfloat ? std::snprintf(buf, sizeof(buf), conv, value)
+                                  : std::snprintf(buf, sizeof(buf), conv, _precision, value);
+            if (length < 0) {
+                return;
+            }
+            if (static_cast<size_t>(length) < sizeof(buf)) {
+                write_padded(buf, length);
+                return;
+            }
+            // large fixed numbers
+            std::vector<char> large(length + 1);
+            if (hexfloat) {
+                std::snprintf(large.data(), large.size(), conv, value);
+            } else {
+                std::snprintf(large.data(), large.size(), conv, _precision, value);
+            }
+            write_padded(large.data(), length);
+        }
+
+    public:
+        char_buffer() = default;
+
+        /**
+         * Wrap a caller-supplied array, which will never grow.
+         *
+         * @param data the array
+         * @param capacity size of the array
+         */
+        char_buffer(char *data, size_t capacity)
+            : _data(data), _capacity(capacity), _growable(false) {}
+
+        char_buffer(const char_buffer &) = delete;
+
+        char_buffer(char_buffer &&) noexcept = delete;
+
+        ~char_buffer() {
+            if (_growable && _data != _inline) {
+                delete[] _data;
+            }
+        }
+
+        char_buffer &operator=(const char_buffer &) = delete;
+
+        char_buffer &operator=(char_buffer &&) = delete;
+
+        const char *data() const {
+            return _data;
+        }
+
+        /**
+         * @return number of characters stored
+         */
+        size_t size() const {
+            return _size;
+        }
+
+        size_t capacity() const {
+            return _capacity;
+        }
+
+        bool empty() const {
+            return _size == 0;
+        }
+
+        /**
+         * @return number of characters that did not fit in a non-growable buffer
+         */
+        size_t dropped() const {
+            return _dropped;
+        }
+
+        /**
+         * Clear contents and formatting state, the storage is kept.
+         */
+        void clear() {
+            _size = 0;
+            _dropped = 0;
+            _flags = fmtflags{};
+            _width = 0;
+            _precision = 6;
+            _fill = ' ';
+        }
+
+        void reserve(size_t capacity) {
+            if (_growable && capacity > _capacity) {
+                grow(capacity);
+            }
+        }
+
+        void append(const char *str, size_t length) {
+            if (_size + length > _capacity) {
+                if (_growable) {
+                    grow(_size + length);
+                } else {
+                    size_t room = _capacity - _size;
+                    _dropped += length - room;
+                    length = room;
+                }
+            }
+            std::memcpy(_data + _size, str, length);
+            _size += length;
+        }
+
+        void append(size_t count, char c) {
+            if (_size + count > _capacity) {
+                if (_growable) {
+                    grow(_size + count);
+                } else {
+                    size_t room = _capacity - _size;
+                    _dropped += count - room;
+                    count = room;
+                }
+            }
+            std::memset(_data + _size, c, count);
+            _size += count;
+        }
+
+        void push_back(char c) {
+            append(1, c);
+        }
+
+        std::string str() const {
+            return std::string(_data, _size);
+        }
+
+        string_ref ref() const {
+            return string_ref(_data, _size);
+        }
+
+        /*
+         * std::ios style formatting state.
+         */
+
+        const fmtflags &flags() const {
+            return _flags;
+        }
+
+        void flags(const fmtflags &flags) {
+            _flags = flags;
+        }
+
+        int width() const {
+            return _width;
+        }
+
+        void width(int width) {
+            _width = width;
+        }
+
+        int precision() const {
+            return _precision;
+        }
+
+        void precision(int precision) {
+            _precision = precision;
+        }
+
+        char fill() const {
+            return _fill;
+        }
+
+        void fill(char fill) {
+            _fill = fill;
+        }
+
+        /**
+         * Set the stream's width, fill, precision and the flags kept
+         * by the buffer to those of the buffer. Other flags of the stream
+         * are left as they are.
+         */
+        void copy_state_to(std::ostream &out) const {
+            out.setf(_flags.left ? std::ios::left : std::ios::right, std::ios::adjustfield);
+            out.setf(_flags.base == 16 ? std::ios::hex : _flags.base == 8 ? std::ios::oct : std::ios::dec,
+                std::ios::basefield);
+            out.setf((_flags.fixed ? std::ios::fixed : std::ios::fmtflags(0))
+                     | (_flags.scientific ? std::ios::scientific : std::ios::fmtflags(0)),
+                std::ios::floatfield);
+            if (_flags.showbase) {
+                out.setf(std::ios::showbase);
+            } else {
+                out.unsetf(std::ios::showbase);
+            }
+            out.width(_width);
+            out.precision(_precision);
+            out.fill(_fill);
+        }
+
+        /*
+         * The stream the buffer formats for.
+         */
+
+        /**
+         * Bind the buffer to the stream it is formatting for: types that
+         * only know how to write themselves into std::ostream are then
+         * written to the stream itself, with its locale and flags, right
+         * after the characters buffered so far are flushed to it.
+         */
+        void bind(std::ostream &stream) {
+            _stream = &stream;
+        }
+
+        std::ostream *stream() const {
+            return _stream;
+        }
+
+        /**
+         * Write the characters buffered so far to the bound stream.
+         */
+        void flush() {
+            if (_stream != nullptr && _size != 0) {
+                _stream->write(_data, _size);
+                _size = 0;
+            }
+        }
+
+        char_buffer &operator<<(char c) {
+            write_padded(&c, 1);
+            return *this;
+        }
+
+        char_buffer &operator<<(signed char c) {
+            return *this << static_cast<char>(c);
+        }
+
+        char_buffer &operator<<(unsigned char c) {
+            return *this << static_cast<char>(c);
+        }
+
+        char_buffer &operator<<(const char *str) {
+            // std::ostream sets badbit on null pointers, nothing is written here
+            if (str == nullptr) {
+                _width = 0;
+                return *this;
+            }
+            write_padded(str, std::char_traits<char>::length(str));
+            return *this;
+        }
+
+        char_buffer &operator<<(const std::string &str) {
+            write_padded(str.data(), str.size());
+            return *this;
+        }
+
+        char_buffer &operator<<(string_ref str) {
+            write_padded(str.data(), str.size());
+            return *this;
+        }
+
+        char_buffer &operator<<(bool b) {
+            // std::ostream writes bool as long without boolalpha
+            write_integer(static_cast<long>(b));
+            return *this;
+        }
+
+        template <typename T>
+        std::enable_if_t<std::is_integral<T>::value, char_buffer &> operator<<(T value) {
+            write_integer(value);
+            return *this;
+        }
+
+        template <typename T>
+        std::enable_if_t<std::is_floating_point<T>::value, char_buffer &> operator<<(T value) {
+            write_floating(value);
+            return *this;
+        }
+    };
+
+    /**
+     * Types that only know how to write themselves into std::ostream
+     * are written to the stream the buffer is bound to, carrying the
+     * state of the buffer, which is undone afterwards. Unbound buffers
+     * format them with a temporary stream.
+     */
+    template <typename T>
+    auto operator<<(char_buffer &buf, const T &val)
+    -> std::enable_if_t<!std::is_arithmetic<T>::value && !std::is_convertible<const T &, string_ref>::value,
+        decltype(std::declval<std::ostream &>() << val, buf)> {
+        if (std::ostream *stream = buf.stream()) {
+            buf.flush();
+            std::ios_base::fmtflags flags = stream->flags();
+            std::streamsize precision = stream->precision();
+            char fill = stream->fill();
+            buf.copy_state_to(*stream);
+            *stream << val;
+            stream->flags(flags);
+            stream->precision(precision);
+            stream->fill(fill);
+            stream->width(0);
+        } else {
+            std::ostringstream out;
+            buf.copy_state_to(out);
+            out << val;
+
+            const std::string &str = out.str();
+            buf.append(str.data(), str.size());
+        }
+        buf.width(0);
+        return buf;
+    }
+}
+
+namespace mpp_impl {
     template <typename Out, typename T>
     void write_value(Out &out, T &&t);
 
@@ -164,6 +1182,79 @@ namespace mpp_impl {
         write_control_impl(out, std::forward<C>(c), true);
     }
 
+    /*
+     * Controls are written as std::ios manipulators to the streams, and set
+     * as fields of char_buffer, which does not depend on any ios state.
+     * The return types of std::setw, std::setfill and std::setprecision
+     * are unspecified, so sinks other than std::ostream cannot accept them.
+     */
+
+    template <typename Out>
+    void write_width(Out &out, int w) {
+        write_control(out, std::setw(w));
+    }
+
+    template <typename Out>
+    void write_fill(Out &out, char fill_ch) {
+        write_control(out, std::setfill(fill_ch));
+    }
+
+    template <typename Out>
+    void write_precision(Out &out, int npoints) {
+        write_control(out, std::setprecision(npoints));
+    }
+
+    template <typename Out>
+    void write_align(Out &out, bool left) {
+        write_control(out, left ? std::left : std::right);
+    }
+
+    template <typename Out>
+    void write_base(Out &out, int base) {
+        write_control(out, std::showbase);
+        write_control(out, base == 16 ? std::hex : base == 8 ? std::oct : std::dec);
+    }
+
+    template <typename Out>
+    void write_float_style(Out &out, bool fixed, bool scientific) {
+        write_control(out, fixed && scientific ? std::hexfloat
+                           : fixed ? std::fixed
+                           : scientific ? std::scientific
+                           : std::defaultfloat);
+    }
+
+    inline void write_align(mpp::char_buffer &out, bool left) {
+        mpp::char_buffer::fmtflags flags = out.flags();
+        flags.left = left;
+        out.flags(flags);
+    }
+
+    inline void write_base(mpp::char_buffer &out, int base) {
+        mpp::char_buffer::fmtflags flags = out.flags();
+        flags.showbase = true;
+        flags.base = base;
+        out.flags(flags);
+    }
+
+    inline void write_float_style(mpp::char_buffer &out, bool fixed, bool scientific) {
+        mpp::char_buffer::fmtflags flags = out.flags();
+        flags.fixed = fixed;
+        flags.scientific = scientific;
+        out.flags(flags);
+    }
+
+    inline void write_width(mpp::char_buffer &out, int w) {
+        out.width(w);
+    }
+
+    inline void write_fill(mpp::char_buffer &out, char fill_ch) {
+        out.fill(fill_ch);
+    }
+
+    inline void write_precision(mpp::char_buffer &out, int npoints) {
+        out.precision(npoints);
+    }
+
     enum class ctflag {
         ALIGN,
         FILL,
@@ -186,8 +1277,8 @@ namespace mpp_impl {
     struct control_writer<ctflag::ALIGN, T> {
         template <typename Out>
         static void doit(Out &out, int w, bool left) {
-            mpp_impl::write_control(out, left ? std::left : std::right);
-            mpp_impl::write_control(out, std::setw(w));
+            mpp_impl::write_align(out, left);
+            mpp_impl::write_width(out, w);
         }
     };
 
@@ -195,7 +1286,7 @@ namespace mpp_impl {
     struct control_writer<ctflag::FILL, T> {
         template <typename Out>
         static void doit(Out &out, char fill_ch) {
-            mpp_impl::write_control(out, std::setfill(fill_ch));
+            mpp_impl::write_fill(out, fill_ch);
         }
     };
 
@@ -203,8 +1294,8 @@ namespace mpp_impl {
     struct control_writer<ctflag::FLOATINGS, T, std::enable_if_t<std::is_floating_point<T>::value>> {
         template <typename Out>
         static void doit(Out &out, int npoints) {
-            mpp_impl::write_control(out, std::fixed);
-            mpp_impl::write_control(out, std::setprecision(npoints));
+            mpp_impl::write_float_style(out, true, false);
+            mpp_impl::write_precision(out, npoints);
         }
     };
 
@@ -212,11 +1303,10 @@ namespace mpp_impl {
     struct control_writer<ctflag::FORMAT_HEX, T> {
         template <typename Out>
         static void doit(Out &out) {
-            mpp_impl::write_control(out, std::showbase);
+            // floatings are written as hexfloat, which ignores the base
+            mpp_impl::write_base(out, 16);
             if (std::is_floating_point<T>::value) {
-                mpp_impl::write_control(out, std::hexfloat);
-            } else {
-                mpp_impl::write_control(out, std::hex);
+                mpp_impl::write_float_style(out, true, true);
             }
         }
     };
@@ -225,8 +1315,7 @@ namespace mpp_impl {
     struct control_writer<ctflag::FORMAT_DEC, T, std::enable_if_t<!std::is_floating_point<T>::value>> {
         template <typename Out>
         static void doit(Out &out) {
-            mpp_impl::write_control(out, std::showbase);
-            mpp_impl::write_control(out, std::dec);
+            mpp_impl::write_base(out, 10);
         }
     };
 
@@ -234,8 +1323,7 @@ namespace mpp_impl {
     struct control_writer<ctflag::FORMAT_OCT, T, std::enable_if_t<!std::is_floating_point<T>::value>> {
         template <typename Out>
         static void doit(Out &out) {
-            mpp_impl::write_control(out, std::showbase);
-            mpp_impl::write_control(out, std::oct);
+            mpp_impl::write_base(out, 8);
         }
     };
 
@@ -243,7 +1331,7 @@ namespace mpp_impl {
     struct control_writer<ctflag::FORMAT_SCI, T, std::enable_if_t<std::is_floating_point<T>::value>> {
         template <typename Out>
         static void doit(Out &out) {
-            mpp_impl::write_control(out, std::scientific);
+            mpp_impl::write_float_style(out, false, true);
         }
     };
 
@@ -277,52 +1365,269 @@ namespace mpp_impl {
         stream_flags_saver &operator=(const stream_flags_saver &) = delete;
     };
 
+    template <>
+    class stream_flags_saver<mpp::char_buffer> {
+    private:
+        mpp::char_buffer::fmtflags _flags;
+        mpp::char_buffer &_out;
+
+    public:
+        explicit stream_flags_saver(mpp::char_buffer &o) : _flags(o.flags()), _out(o) {}
+
+        ~stream_flags_saver() {
+            _out.flags(_flags);
+        }
+
+        stream_flags_saver(stream_flags_saver &&) = delete;
+        stream_flags_saver(const stream_flags_saver &) = delete;
+        stream_flags_saver &operator=(stream_flags_saver &&) = delete;
+        stream_flags_saver &operator=(const stream_flags_saver &) = delete;
+    };
+
+    /**
+     * Parsed form of a single placeholder, see the grammar
+     * described in the <mozart++/format> header.
+     */
+    struct placeholder_spec {
+        // <floating-points>, -1 if not specified
+        int precision = -1;
+        // <output-format>, '\0' if not specified
+        char format = '\0';
+        // <alignment>, -1 if not specified
+        int width = -1;
+        bool left = false;
+        bool has_fill = false;
+        char fill = ' ';
+    };
+
+    /**
+     * A placeholder found in the format string.
+     */
+    struct placeholder {
+        // position of the opening brace
+        size_t position = 0;
+        // length of the whole placeholder, braces included
+        size_t length = 0;
+        placeholder_spec spec;
+    };
+
+    constexpr const char *parse_number(const char *p, const char *end, int &value) {
+        value = 0;
+        while (p != end && *p >= '0' && *p <= '9') {
+            value = value * 10 + (*p++ - '0');
+        }
+        return p;
+    }
+
+    /**
+     * Match a placeholder starting exactly at the opening brace p.
+     * This is a hand-written equivalent of the regular expression
+     * \{(\.[0-9]+)?([xdoe])?(\:\-?[0-9]+(\|.)?)?\}
+     * which was used by the formatter before.
+     *
+     * @param p the opening brace
+     * @param end end of the format string
+     * @param spec where to store the parsed placeholder
+     * @return the position after the closing brace, or nullptr if not matched
+     */
+    constexpr const char *parse_placeholder(const char *p, const char *end, placeholder_spec &spec) {
+        spec = placeholder_spec{};
+        if (p == end || *p++ != '{') {
+            return nullptr;
+        }
+
+        if (p != end && *p == '.') {
+            const char *digits = p + 1;
+            p = parse_number(digits, end, spec.precision);
+            if (p == digits) {
+                return nullptr;
+            }
+        }
+
+        if (p != end && (*p == 'x' || *p == 'd' || *p == 'o' || *p == 'e')) {
+            spec.format = *p++;
+        }
+
+        if (p != end && *p == ':') {
+            ++p;
+            if (p != end && *p == '-') {
+                spec.left = true;
+                ++p;
+            }
+            const char *digits = p;
+            p = parse_number(digits, end, spec.width);
+            if (p == digits) {
+                return nullptr;
+            }
+            // the regex dot matches anything except line terminators
+            if (p != end && *p == '|' && end - p > 2
+                && p[1] != '\n' && p[1] != '\r' && p[2] == '}') {
+                spec.has_fill = true;
+                spec.fill = p[1];
+                p += 2;
+            }
+        }
+
+        if (p == end || *p != '}') {
+            return nullptr;
+        }
+        return p + 1;
+    }
+
+    /**
+     * Search for the leftmost placeholder in fmt starting from start_index.
+     *
+     * @param fmt format string
+     * @param start_index where to start the search
+     * @param holder where to store the found placeholder
+     * @return true if found
+     */
+    inline bool find_placeholder(mpp::string_ref fmt, size_t start_index, placeholder &holder) {
+        const char *end = fmt.end();
+        size_t pos = start_index;
+        while ((pos = fmt.find('{', pos)) != mpp::string_ref::npos) {
+            const char *last = parse_placeholder(fmt.data() + pos, end, holder.spec);
+            if (last != nullptr) {
+                holder.position = pos;
+                holder.length = last - (fmt.data() + pos);
+                return true;
+            }
+            ++pos;
+        }
+        return false;
+    }
+
+    template <typename Out, typename = void>
+    struct text_writer {
+        template <typename O>
+        static void doit(O &out, mpp::string_ref text) {
+            write_value(out, text.str());
+        }
+    };
+
+    template <typename Out>
+    struct text_writer<Out, std::enable_if_t<std::is_base_of<std::ostream, Out>::value>> {
+        template <typename O>
+        static void doit(O &out, mpp::string_ref text) {
+            // the text is written before any controls are set,
+            // so unformatted output is exactly the same here.
+            out.write(text.data(), text.size());
+        }
+    };
+
+    template <>
+    struct text_writer<mpp::char_buffer> {
+        static void doit(mpp::char_buffer &out, mpp::string_ref text) {
+            out.append(text.data(), text.size());
+        }
+    };
+
+    /**
+     * Write the literal text between placeholders.
+     */
+    template <typename Out>
+    void write_text(Out &out, mpp::string_ref text) {
+        text_writer<Out>::doit(out, text);
+    }
+
+    /**
+     * Formats for std::ostream are done in a char_buffer starting with
+     * the stream's formatting state, and then written to the stream at
+     * once. The stream is left as formatting to it directly would leave
+     * it: the flags as they were, the fill and precision as last set.
+     * The buffer is bound to the stream, which writes the values of
+     * user types.
+     *
+     * Streams with flags the buffer does not keep (boolalpha, showpos,
+     * uppercase, showpoint, internal) or a locale other than the classic
+     * one are formatted to directly.
+     */
+    template <typename Out, typename = void>
+    struct output_adaptor {
+        template <typename F>
+        static void doit(Out &out, F &&f) {
+            f(out);
+        }
+    };
+
+    template <typename Out>
+    struct output_adaptor<Out, std::enable_if_t<std::is_base_of<std::ostream, Out>::value>> {
+        template <typename F>
+        static void doit(Out &out, F &&f) {
+            std::ios_base::fmtflags ios_flags = out.flags();
+            if ((ios_flags & ~buffered_flags) != 0 || out.getloc() != std::locale::classic()) {
+                f(out);
+                return;
+            }
+
+            std::ios_base::fmtflags base = ios_flags & std::ios_base::basefield;
+            mpp::char_buffer::fmtflags flags;
+            flags.left = (ios_flags & std::ios_base::left) != 0;
+            flags.showbase = (ios_flags & std::ios_base::showbase) != 0;
+            flags.fixed = (ios_flags & std::ios_base::fixed) != 0;
+            flags.scientific = (ios_flags & std::ios_base::scientific) != 0;
+            flags.base = base == std::ios_base::hex ? 16 : base == std::ios_base::oct ? 8 : 10;
+
+            mpp::char_buffer buffer;
+            buffer.bind(out);
+            buffer.flags(flags);
+            buffer.precision(static_cast<int>(out.precision()));
+            buffer.fill(out.fill());
+            buffer.width(static_cast<int>(out.width()));
+            out.width(0);
+
+            f(buffer);
+            buffer.flush();
+            out.fill(buffer.fill());
+            out.precision(buffer.precision());
+        }
+
+    private:
+        // skipws and unitbuf do not change the output
+        static constexpr std::ios_base::fmtflags buffered_flags =
+            std::ios_base::left | std::ios_base::right | std::ios_base::basefield | std::ios_base::showbase
+            | std::ios_base::fixed | std::ios_base::scientific | std::ios_base::skipws | std::ios_base::unitbuf;
+    };
+
+    template <typename Out, typename F>
+    void format_through(Out &out, F &&f) {
+        output_adaptor<Out>::doit(out, std::forward<F>(f));
+    }
+
     template <typename Out, typename T>
-    void write_value_and_control(Out &out, T &&t, const match_t &match) {
+    void write_value_and_control(Out &out, T &&t, const placeholder_spec &spec) {
         using actual_type = remove_cr_t<T>;
-        const std::string &floats = match.str(1);
-        const std::string &formats = match.str(2);
-        const std::string &align = match.str(3);
 
         // restore format flags for the next format cycle.
         stream_flags_saver<Out> saver(out);
 
-        if (!floats.empty()) {
-            // regex ensures the atoi will never fail
-            int npoints = ::atoi(floats.c_str() + 1);
-            control_writer<ctflag::FLOATINGS, actual_type>::doit(out, npoints);
+        if (spec.precision >= 0) {
+            control_writer<ctflag::FLOATINGS, actual_type>::doit(out, spec.precision);
         }
 
-        if (!formats.empty()) {
-            switch (*formats.c_str()) {
-                case 'x':
-                    control_writer<ctflag::FORMAT_HEX, actual_type>::doit(out);
-                    break;
-                case 'o':
-                    control_writer<ctflag::FORMAT_OCT, actual_type>::doit(out);
-                    break;
-                case 'd':
-                    control_writer<ctflag::FORMAT_DEC, actual_type>::doit(out);
-                    break;
-                case 'e':
-                    control_writer<ctflag::FORMAT_SCI, actual_type>::doit(out);
-                    break;
-                default:
-                    break;
-            }
+        switch (spec.format) {
+            case 'x':
+                control_writer<ctflag::FORMAT_HEX, actual_type>::doit(out);
+                break;
+            case 'o':
+                control_writer<ctflag::FORMAT_OCT, actual_type>::doit(out);
+                break;
+            case 'd':
+                control_writer<ctflag::FORMAT_DEC, actual_type>::doit(out);
+                break;
+            case 'e':
+                control_writer<ctflag::FORMAT_SCI, actual_type>::doit(out);
+                break;
+            default:
+                break;
         }
 
-        if (!align.empty()) {
-            bool left = *(align.c_str() + 1) == '-';
-            // regex ensures the atoi will never fail
-            int width = ::atoi(left ? align.c_str() + 2 : align.c_str() + 1);
-            control_writer<ctflag::ALIGN, actual_type>::doit(out, width, left);
+        if (spec.width >= 0) {
+            control_writer<ctflag::ALIGN, actual_type>::doit(out, spec.width, spec.left);
 
             // check the fill control flag
-            const std::string &fill = match.str(4);
-            if (!fill.empty()) {
-                char fill_ch = *(fill.c_str() + 1);
-                control_writer<ctflag::FILL, actual_type>::doit(out, fill_ch);
+            if (spec.has_fill) {
+                control_writer<ctflag::FILL, actual_type>::doit(out, spec.fill);
             }
         }
 
@@ -330,18 +1635,15 @@ namespace mpp_impl {
     }
 
     template <typename Out, typename T>
-    bool try_format_one(Out &out, mpp::string_ref &fmt, const std::regex &re, T &&t) {
-        string_iter_t begin = fmt.begin();
-        string_iter_t end = fmt.end();
-
-        std::regex_iterator<string_iter_t> re_begin(begin, end, re), re_end;
-        if (re_begin != re_end) {
-            // text before the match
-            write_value(out, fmt.slice(0, re_begin->position(0)).str());
-            // the match itself
-            write_value_and_control(out, std::forward<T>(t), *re_begin);
+    bool format_impl(Out &out, mpp::string_ref &fmt, T &&t) {
+        placeholder holder;
+        if (find_placeholder(fmt, 0, holder)) {
+            // text before the placeholder
+            write_text(out, fmt.slice(0, holder.position));
+            // the placeholder itself
+            write_value_and_control(out, std::forward<T>(t), holder.spec);
             // the rest text to be matched next time
-            fmt = fmt.substr(re_begin->position(0) + re_begin->length(0));
+            fmt = fmt.substr(holder.position + holder.length);
             // be greedy
             return true;
         }
@@ -349,12 +1651,6 @@ namespace mpp_impl {
         return false;
     }
 
-    template <typename Out, typename T>
-    bool format_impl(Out &out, mpp::string_ref &fmt, T &&t) {
-        std::regex r(R"(\{(\.[0-9]+)?([xdoe])?(\:\-?[0-9]+(\|.)?)?\})");
-        return try_format_one(out, fmt, r, std::forward<T>(t));
-    }
-
     template <typename Out, typename T, typename ...Args>
     void format_impl(Out &out, mpp::string_ref &fmt, T &&head, Args &&... args) {
         if (!mpp_impl::format_impl(out, fmt, std::forward<T>(head))) {
@@ -364,32 +1660,350 @@ namespace mpp_impl {
         mpp_impl::format_impl(out, fmt, std::forward<Args>(args)...);
     }
 
+    /**
+     * Strings are format strings, not outputs. This avoids ambiguity
+     * between format(out, fmt, args...) and format(fmt, args...).
+     */
     template <typename Out>
+    using requires_output = mpp::requires_true<!std::is_convertible<Out &, std::string>::value>;
+
+    template <typename Out, typename = requires_output<Out>>
     void format(Out &out, const std::string &fmt) {
         write_value(out, fmt);
     }
 
-    template <typename Out, typename ...Args>
+    template <typename Out, typename ...Args, typename = requires_output<Out>>
     void format(Out &out, const std::string &fmt, Args &&... args) {
-        mpp::string_ref fmt_ref{fmt};
-        mpp_impl::format_impl(out, fmt_ref, std::forward<Args>(args)...);
-        if (!fmt_ref.empty()) {
-            write_value(out, fmt_ref.str());
+        format_through(out, [&](auto &sink) {
+            mpp::string_ref fmt_ref{fmt};
+            mpp_impl::format_impl(sink, fmt_ref, std::forward<Args>(args)...);
+            if (!fmt_ref.empty()) {
+                write_text(sink, fmt_ref);
+            }
+        });
+    }
+}
+
+namespace mpp {
+    /**
+     * A format string parsed once and reusable for any number of
+     * format calls. It holds the format string and the placeholders
+     * found in it, so formatting with it does no parsing at all.
+     * The output is the same as {@code mpp::format()} with the same format string.
+     *
+     * Use mpp_cached_format("...") to get a compiled format cached
+     * at the call site.
+     */
+    class compiled_format {
+        std::string _fmt;
+        std::vector<mpp_impl::placeholder> _holders;
+
+        template <typename Out>
+        void format_impl(Out &, size_t &, size_t) const {
+        }
+
+        template <typename Out, typename T, typename ...Args>
+        void format_impl(Out &out, size_t &last, size_t index, T &&head, Args &&... args) const {
+            if (index == _holders.size()) {
+                // nothing to format (no more {...})
+                return;
+            }
+            const mpp_impl::placeholder &holder = _holders[index];
+            mpp_impl::write_text(out, string_ref(_fmt).slice(last, holder.position));
+            mpp_impl::write_value_and_control(out, std::forward<T>(head), holder.spec);
+            last = holder.position + holder.length;
+            format_impl(out, last, index + 1, std::forward<Args>(args)...);
+        }
+
+    public:
+        explicit compiled_format(std::string fmt) : _fmt(std::move(fmt)) {
+            mpp_impl::placeholder holder;
+            size_t pos = 0;
+            while (mpp_impl::find_placeholder(_fmt, pos, holder)) {
+                _holders.push_back(holder);
+                pos = holder.position + holder.length;
+            }
+        }
+
+        /**
+         * @return the original format string
+         */
+        const std::string &str() const {
+            return _fmt;
+        }
+
+        /**
+         * @return number of placeholders in the format string
+         */
+        size_t placeholders() const {
+            return _holders.size();
+        }
+
+        template <typename Out, typename ...Args>
+        void format(Out &out, Args &&... args) const {
+            if (sizeof...(args) == 0) {
+                mpp_impl::write_value(out, _fmt);
+                return;
+            }
+            mpp_impl::format_through(out, [&](auto &sink) {
+                size_t last = 0;
+                this->format_impl(sink, last, 0, std::forward<Args>(args)...);
+                if (last != _fmt.size()) {
+                    mpp_impl::write_text(sink, string_ref(_fmt).substr(last));
+                }
+            });
+        }
+
+        /**
+         * Append the formatted text to the buffer.
+         */
+        template <typename ...Args>
+        void format_to(char_buffer &buffer, Args &&... args) const {
+            format(buffer, std::forward<Args>(args)...);
+        }
+
+        template <typename ...Args>
+        void format_to(std::string &buffer, Args &&... args) const {
+            char_buffer out;
+            format(out, std::forward<Args>(args)...);
+            buffer.append(out.data(), out.size());
+        }
+    };
+}
+
+/**
+ * Get a compiled format of the string literal fmt, which is
+ * parsed only once, when the call site is first executed.
+ */
+#define mpp_cached_format(fmt) \
+    ([]() -> const ::mpp::compiled_format & { \
+        static const ::mpp::compiled_format cached_format(fmt); \
+        return cached_format; \
+    }())
+
+namespace mpp {
+    /**
+     * Base class of format strings created by mpp_format_string("..."),
+     * which are parsed and checked against the arguments at compile time.
+     */
+    struct format_string_base {
+    };
+
+    template <typename S>
+    using is_format_string = std::is_base_of<format_string_base, S>;
+}
+
+/**
+ * Make a format string from the string literal fmt, whose placeholders
+ * are parsed at compile time. Formatting with it static_asserts that
+ * the number of arguments matches the placeholders, and that every
+ * output format is supported by the type of its argument.
+ */
+#define mpp_format_string(fmt) \
+    ([]() { \
+        struct mpp_format_string_t : ::mpp::format_string_base { \
+            static constexpr const char *data() { return fmt; } \
+            static constexpr size_t size() { return sizeof(fmt) - 1; } \
+        }; \
+        return mpp_format_string_t{}; \
+    }())
+
+namespace mpp_impl {
+    constexpr size_t count_placeholders(const char *fmt, size_t size) {
+        size_t count = 0;
+        placeholder_spec spec;
+        for (const char *p = fmt, *end = fmt + size; p != end;) {
+            const char *last = parse_placeholder(p, end, spec);
+            if (last != nullptr) {
+                ++count;
+                p = last;
+            } else {
+                ++p;
+            }
+        }
+        return count;
+    }
+
+    template <size_t N>
+    struct placeholder_table {
+        placeholder holders[N == 0 ? 1 : N];
+    };
+
+    template <size_t N>
+    constexpr placeholder_table<N> make_placeholder_table(const char *fmt, size_t size) {
+        placeholder_table<N> table{};
+        size_t count = 0;
+        for (const char *p = fmt, *end = fmt + size; p != end && count != N;) {
+            placeholder &holder = table.holders[count];
+            const char *last = parse_placeholder(p, end, holder.spec);
+            if (last != nullptr) {
+                holder.position = p - fmt;
+                holder.length = last - p;
+                ++count;
+                p = last;
+            } else {
+                ++p;
+            }
         }
+        return table;
     }
+
+    /**
+     * Check that the output format in spec is supported by type T,
+     * see the control_writer specializations.
+     */
+    template <typename T>
+    constexpr bool check_placeholder(const placeholder_spec &spec) {
+        if (std::is_floating_point<T>::value) {
+            return spec.format != 'd' && spec.format != 'o';
+        }
+        return spec.precision < 0 && spec.format != 'e';
+    }
+
+    /**
+     * Placeholders of the format string S, parsed at compile time.
+     */
+    template <typename S>
+    struct static_format {
+        static constexpr size_t count = count_placeholders(S::data(), S::size());
+        static constexpr placeholder_table<count> table = make_placeholder_table<count>(S::data(), S::size());
+
+        static constexpr size_t text_begin(size_t index) {
+            return index == 0 ? 0 : table.holders[index - 1].position + table.holders[index - 1].length;
+        }
+
+        template <size_t I, typename Out, typename T>
+        static void write_one(Out &out, T &&t) {
+            static_assert(check_placeholder<remove_cr_t<T>>(table.holders[I].spec),
+                "mpp::format: output format in placeholder is not supported by the argument type");
+            constexpr size_t begin = text_begin(I);
+            constexpr size_t end = table.holders[I].position;
+            if (begin != end) {
+                write_text(out, mpp::string_ref(S::data() + begin, end - begin));
+            }
+            write_value_and_control(out, std::forward<T>(t), table.holders[I].spec);
+        }
+
+        template <typename Out, size_t ...I, typename ...Args>
+        static void write(Out &out, std::index_sequence<I...>, Args &&... args) {
+            int expand[] = {0, (write_one<I>(out, std::forward<Args>(args)), 0)...};
+            (void) expand;
+            constexpr size_t begin = text_begin(count);
+            if (begin != S::size()) {
+                write_text(out, mpp::string_ref(S::data() + begin, S::size() - begin));
+            }
+        }
+
+        template <typename Out, typename ...Args>
+        static void format(Out &out, Args &&... args) {
+            static_assert(count == sizeof...(Args),
+                "mpp::format: number of arguments does not match the placeholders");
+            write(out, std::make_index_sequence<count == sizeof...(Args) ? count : 0>(),
+                std::forward<Args>(args)...);
+        }
+    };
+
+    template <typename S>
+    constexpr size_t static_format<S>::count;
+
+    template <typename S>
+    constexpr placeholder_table<static_format<S>::count> static_format<S>::table;
 }
 
 namespace mpp {
     using mpp_impl::format;
 
+    /**
+     * Number of placeholders in the string literal, at compile time.
+     */
+    template <size_t N>
+    constexpr size_t format_placeholders(const char (&fmt)[N]) {
+        return mpp_impl::count_placeholders(fmt, N - 1);
+    }
+
+    template <typename Out, typename S, typename ...Args>
+    std::enable_if_t<is_format_string<S>::value> format(Out &out, S, Args &&... args) {
+        mpp_impl::format_through(out, [&](auto &sink) {
+            mpp_impl::static_format<S>::format(sink, std::forward<Args>(args)...);
+        });
+    }
+
     static std::string format(const std::string &fmt) {
         return fmt;
     }
 
+    /**
+     * Append the formatted text to the buffer.
+     *
+     * @param buffer the buffer
+     * @param fmt format string
+     */
+    inline void format_to(char_buffer &buffer, string_ref fmt) {
+        buffer.append(fmt.data(), fmt.size());
+    }
+
+    template <typename ...Args>
+    void format_to(char_buffer &buffer, string_ref fmt, Args &&... args) {
+        mpp_impl::format_impl(buffer, fmt, std::forward<Args>(args)...);
+        if (!fmt.empty()) {
+            mpp_impl::write_text(buffer, fmt);
+        }
+    }
+
+    template <typename ...Args>
+    void format_to(char_buffer &buffer, const compiled_format &fmt, Args &&... args) {
+        fmt.format(buffer, std::forward<Args>(args)...);
+    }
+
+    template <typename S, typename ...Args>
+    std::enable_if_t<is_format_string<S>::value> format_to(char_buffer &buffer, S, Args &&... args) {
+        mpp_impl::static_format<S>::format(buffer, std::forward<Args>(args)...);
+    }
+
+    /**
+     * Result of format_to_n()
+     */
+    struct format_to_n_result {
+        // past the last character written
+        char *out;
+        // length of the whole formatted text, which may exceed the array
+        size_t size;
+    };
+
+    /**
+     * Format into the array of n characters, characters that do
+     * not fit are dropped. The array is not null-terminated.
+     *
+     * @param out the array
+     * @param n size of the array
+     * @param fmt format string, or a compiled_format
+     * @return {@see format_to_n_result}
+     */
+    template <typename Fmt, typename ...Args>
+    format_to_n_result format_to_n(char *out, size_t n, Fmt &&fmt, Args &&... args) {
+        char_buffer buffer(out, n);
+        format_to(buffer, std::forward<Fmt>(fmt), std::forward<Args>(args)...);
+        return format_to_n_result{out + buffer.size(), buffer.size() + buffer.dropped()};
+    }
+
     template <typename ...Args>
     std::string format(const std::string &fmt, Args &&... args) {
-        std::stringstream out;
-        format(out, fmt, std::forward<Args>(args)...);
+        char_buffer out;
+        format_to(out, fmt, std::forward<Args>(args)...);
+        return out.str();
+    }
+
+    template <typename ...Args>
+    std::string format(const compiled_format &fmt, Args &&... args) {
+        char_buffer out;
+        fmt.format(out, std::forward<Args>(args)...);
+        return out.str();
+    }
+
+    template <typename S, typename ...Args>
+    std::enable_if_t<is_format_string<S>::value, std::string> format(S, Args &&... args) {
+        char_buffer out;
+        mpp_impl::static_format<S>::format(out, std::forward<Args>(args)...);
         return out.str();
     }
 }
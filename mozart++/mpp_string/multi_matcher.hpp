@@ -0,0 +1,312 @@
+/**
+ * Mozart++ Template Library: String/Multi Matcher
+ * Licensed under Apache 2.0
+ * Copyright (C) 2020-2021 Chengdu Covariant Technologies Co., LTD.
+ * Website: https://covariant.cn/
+ * Github:  https://github.com/chengdu-zhirui/
+ */
+
+#pragma once
+
+#include "string.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <initializer_list>
+#include <vector>
+
+namespace mpp {
+    /**
+     * Search for any of a set of patterns in a single pass over the text.
+     *
+     * The patterns are compiled once into an Aho-Corasick automaton whose
+     * transitions are all resolved into one table, indexed by byte classes
+     * (bytes used by no pattern share a class) to keep the table small.
+     * While the automaton is at its root, the text is skipped ahead to the
+     * next position where the first bytes of some pattern may match, with
+     * a SIMD prefix filter.
+     *
+     * Every occurrence of every pattern is reported, overlapping ones too,
+     * in the order of their end positions, and longer patterns first among
+     * those ending at the same position. Empty patterns never match.
+     */
+    class multi_matcher {
+    public:
+        /**
+         * A pattern found in the text.
+         */
+        struct match {
+            // index of the first matched char in the text
+            size_t position;
+            size_t length;
+            // index of the pattern in the list given to the constructor
+            size_t pattern;
+        };
+
+    private:
+        static constexpr std::uint32_t no_state = ~std::uint32_t(0);
+        static constexpr std::uint32_t report_flag = std::uint32_t(1) << 31;
+
+        bool _ignore_case = false;
+        size_t _patterns = 0;
+        std::vector<size_t> _lengths;
+
+        // byte to byte class
+        std::uint16_t _classes[256] = {};
+        size_t _class_count = 1;
+
+        // transitions, _class_count per state, holding the index of the
+        // next state's row, with report_flag set if the state has outputs
+        std::vector<std::uint32_t> _delta;
+        // patterns ending at each state
+        std::vector<std::vector<size_t>> _outputs;
+        // the nearest proper suffix state with outputs, or no_state
+        std::vector<std::uint32_t> _output_links;
+
+        // positions where a pattern may start
+        mpp_impl::prefix_filter _filter;
+
+        std::uint8_t fold(char c) const {
+            auto b = static_cast<std::uint8_t>(c);
+            return _ignore_case ? mpp_impl::ascii_fold(b) : b;
+        }
+
+        std::uint32_t add_state() {
+            _delta.resize(_delta.size() + _class_count, std::uint32_t(no_state));
+            _outputs.emplace_back();
+            _output_links.push_back(std::uint32_t(no_state));
+            return static_cast<std::uint32_t>(_outputs.size() - 1);
+        }
+
+        void build_filter(const string_ref *patterns, size_t count) {
+            size_t width = mpp_impl::prefix_filter::max_width;
+            for (size_t i = 0; i != count; ++i) {
+                if (!patterns[i].empty()) {
+                    width = std::min(width, patterns[i].size());
+                }
+            }
+            _filter.width = width;
+
+            // Patterns sharing their first bytes go to the same bucket,
+            // which keeps the buckets from passing too many positions.
+            std::vector<std::string> prefixes;
+            for (size_t i = 0; i != count; ++i) {
+                if (patterns[i].empty()) {
+                    continue;
+                }
+                std::string prefix(width, '\0');
+                for (size_t k = 0; k != width; ++k) {
+                    prefix[k] = static_cast<char>(fold(patterns[i][k]));
+                }
+                prefixes.push_back(std::move(prefix));
+            }
+            std::sort(prefixes.begin(), prefixes.end());
+            prefixes.erase(std::unique(prefixes.begin(), prefixes.end()), prefixes.end());
+
+            for (size_t i = 0; i != prefixes.size(); ++i) {
+                auto bucket = static_cast<unsigned>(i * 8 / prefixes.size());
+                for (size_t k = 0; k != width; ++k) {
+                    auto b = static_cast<std::uint8_t>(prefixes[i][k]);
+                    _filter.add(k, b, bucket);
+                    if (_ignore_case && b >= 'a' && b <= 'z') {
+                        _filter.add(k, static_cast<std::uint8_t>(b - 'a' + 'A'), bucket);
+                    }
+                }
+            }
+        }
+
+        void build(const string_ref *patterns, size_t count) {
+            _patterns = count;
+            _lengths.reserve(count);
+
+            // Assign a class to every byte used by the patterns.
+            bool used[256] = {};
+            for (size_t i = 0; i != count; ++i) {
+                for (char c : patterns[i]) {
+                    used[fold(c)] = true;
+                }
+            }
+            for (unsigned b = 0; b != 256; ++b) {
+                if (used[b]) {
+                    _classes[b] = static_cast<std::uint16_t>(_class_count++);
+                }
+            }
+            if (_ignore_case) {
+                for (unsigned b = 'A'; b <= 'Z'; ++b) {
+                    _classes[b] = _classes[mpp_impl::ascii_fold(static_cast<std::uint8_t>(b))];
+                }
+            }
+
+            // Build the trie.
+            add_state();
+            for (size_t i = 0; i != count; ++i) {
+                string_ref pattern = patterns[i];
+                _lengths.push_back(pattern.size());
+                if (pattern.empty()) {
+                    continue;
+                }
+                std::uint32_t state = 0;
+                for (char c : pattern) {
+                    size_t edge = state * _class_count + _classes[fold(c)];
+                    if (_delta[edge] == no_state) {
+                        std::uint32_t next = add_state();
+                        _delta[edge] = next;
+                    }
+                    state = _delta[edge];
+                }
+                _outputs[state].push_back(i);
+            }
+            build_filter(patterns, count);
+
+            // Resolve the failure transitions breadth-first, so the failure
+            // state of a state is always resolved before the state itself.
+            std::vector<std::uint32_t> fail(_outputs.size(), 0);
+            std::vector<std::uint32_t> queue;
+            queue.reserve(_outputs.size());
+            queue.push_back(0);
+            for (size_t head = 0; head != queue.size(); ++head) {
+                std::uint32_t state = queue[head];
+                for (size_t cls = 0; cls != _class_count; ++cls) {
+                    std::uint32_t &next = _delta[state * _class_count + cls];
+                    std::uint32_t fallback = state == 0 ? 0 : _delta[fail[state] * _class_count + cls];
+                    if (next == no_state) {
+                        next = fallback;
+                        continue;
+                    }
+                    fail[next] = fallback;
+                    _output_links[next] = _outputs[fallback].empty() ? _output_links[fallback] : fallback;
+                    queue.push_back(next);
+                }
+            }
+
+            if (_delta.size() >= report_flag) {
+                mpp::throw_ex<mpp::runtime_error>("multi_matcher: too many patterns");
+            }
+            for (std::uint32_t &next : _delta) {
+                bool reports = !_outputs[next].empty() || _output_links[next] != no_state;
+                next = static_cast<std::uint32_t>(next * _class_count) | (reports ? report_flag : 0);
+            }
+        }
+
+        /**
+         * Report the patterns ending at the state to f.
+         *
+         * @return true if stopped by f
+         */
+        template <typename F>
+        bool report(std::uint32_t state, size_t stop, F &f) const {
+            for (std::uint32_t out = _outputs[state].empty() ? _output_links[state] : state;
+                 out != no_state; out = _output_links[out]) {
+                for (size_t pattern : _outputs[out]) {
+                    if (f(match{stop - _lengths[pattern], _lengths[pattern], pattern})) {
+                        return true;
+                    }
+                }
+            }
+            return false;
+        }
+
+        /**
+         * Run the automaton over the text until f returns true.
+         *
+         * @return true if stopped by f
+         */
+        template <typename F>
+        bool scan(string_ref text, F &&f) const {
+            const char *begin = text.begin();
+            const char *end = text.end();
+            const std::uint32_t *delta = _delta.data();
+            const std::uint16_t *classes = _classes;
+            std::uint32_t row = 0;
+            for (const char *p = begin; p != end; ++p) {
+                if (row == 0) {
+                    p = mpp_impl::scan_prefix(p, end, _filter);
+                    if (p == nullptr) {
+                        break;
+                    }
+                }
+                row = delta[row + classes[static_cast<std::uint8_t>(*p)]];
+                if (row & report_flag) {
+                    row &= ~report_flag;
+                    if (report(static_cast<std::uint32_t>(row / _class_count), p - begin + 1, f)) {
+                        return true;
+                    }
+                }
+            }
+            return false;
+        }
+
+    public:
+        /**
+         * Compile the patterns.
+         *
+         * @param patterns the patterns, which are not referenced afterwards
+         * @param ignore_case true to match ASCII letters case insensitively
+         */
+        explicit multi_matcher(const std::vector<string_ref> &patterns, bool ignore_case = false)
+                : _ignore_case(ignore_case) {
+            build(patterns.data(), patterns.size());
+        }
+
+        multi_matcher(std::initializer_list<string_ref> patterns, bool ignore_case = false)
+                : _ignore_case(ignore_case) {
+            build(patterns.begin(), patterns.size());
+        }
+
+        /**
+         * @return the number of patterns
+         */
+        size_t size() const {
+            return _patterns;
+        }
+
+        bool ignore_case() const {
+            return _ignore_case;
+        }
+
+        /**
+         * Call f with every match in the text.
+         *
+         * @param f callable with a const match &
+         */
+        template <typename F>
+        void for_each_match(string_ref text, F &&f) const {
+            scan(text, [&f](const match &m) {
+                f(m);
+                return false;
+            });
+        }
+
+        /**
+         * @return all the matches in the text
+         */
+        std::vector<match> find_all(string_ref text) const {
+            std::vector<match> matches;
+            for_each_match(text, [&matches](const match &m) {
+                matches.push_back(m);
+            });
+            return matches;
+        }
+
+        /**
+         * Find the match that ends first.
+         *
+         * @return true if found
+         */
+        bool find_first(string_ref text, match &result) const {
+            return scan(text, [&result](const match &m) {
+                result = m;
+                return true;
+            });
+        }
+
+        /**
+         * @return true if any pattern occurs in the text
+         */
+        bool contains_any(string_ref text) const {
+            return scan(text, [](const match &) {
+                return true;
+            });
+        }
+    };
+}
@@ -0,0 +1,1002 @@
+/**
+ * Mozart++ Template Library: String/SIMD
+ * Licensed under Apache 2.0
+ * Copyright (C) 2020-2021 Chengdu Covariant Technologies Co., LTD.
+ * Website: https://covariant.cn/
+ * Github:  https://github.com/chengdu-zhirui/
+ */
+
+#pragma once
+
+#include <mozart++/core>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/**
+ * define MOZART_NO_SIMD to use the scalar code only
+ */
+#if !defined(MOZART_NO_SIMD) && (defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86))
+#define MOZART_ARCH_X86
+#endif
+
+#if defined(MOZART_ARCH_X86) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define MOZART_SIMD_SSE2
+#include <immintrin.h>
+
+/**
+ * SSSE3 and AVX2 code is compiled for the function only and
+ * chosen at runtime, so no -mssse3 or -mavx2 is required.
+ */
+#define MOZART_SIMD_SSSE3
+#define MOZART_SIMD_AVX2
+#ifdef _MSC_VER
+#include <intrin.h>
+#define MOZART_TARGET_SSSE3
+#define MOZART_TARGET_AVX2
+#else
+#define MOZART_TARGET_SSSE3 __attribute__((target("ssse3")))
+#define MOZART_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+namespace mpp_impl {
+    /**
+     * Instruction sets supported by the running CPU.
+     */
+    struct cpu_features {
+        bool sse2 = false;
+        bool ssse3 = false;
+        bool avx2 = false;
+
+        static const cpu_features &get() {
+            static const cpu_features features = detect();
+            return features;
+        }
+
+    private:
+        static cpu_features detect() {
+            cpu_features features;
+#if defined(MOZART_SIMD_SSE2)
+            features.sse2 = true;
+#if defined(_MSC_VER)
+            int info[4];
+            __cpuid(info, 0);
+            int max_leaf = info[0];
+            __cpuid(info, 1);
+            features.ssse3 = (info[2] & (1 << 9)) != 0;
+            if (max_leaf >= 7) {
+                // the OS saves the ymm registers
+                bool osxsave = (info[2] & (1 << 27)) != 0;
+                bool avx = (info[2] & (1 << 28)) != 0;
+                __cpuidex(info, 7, 0);
+                features.avx2 = osxsave && avx && (info[1] & (1 << 5)) != 0
+                                && (_xgetbv(0) & 6) == 6;
+            }
+#else
+            __builtin_cpu_init();
+            features.ssse3 = __builtin_cpu_supports("ssse3") != 0;
+            features.avx2 = __builtin_cpu_supports("avx2") != 0;
+#endif
+#endif
+            return features;
+        }
+    };
+
+    inline unsigned count_trailing_zeros(std::uint32_t value) {
+#ifdef _MSC_VER
+        unsigned long index;
+        _BitScanForward(&index, value);
+        return static_cast<unsigned>(index);
+#else
+        return static_cast<unsigned>(__builtin_ctz(value));
+#endif
+    }
+
+    inline unsigned highest_bit(std::uint32_t value) {
+#ifdef _MSC_VER
+        unsigned long index;
+        _BitScanReverse(&index, value);
+        return static_cast<unsigned>(index);
+#else
+        return 31u - static_cast<unsigned>(__builtin_clz(value));
+#endif
+    }
+
+    /**
+     * Candidates found by the fast searches are checked with memcmp,
+     * which is O(n*m) for needles like "aaa...ab". Once the checks cost
+     * more than this many bytes per byte scanned, the search switches to
+     * Knuth-Morris-Pratt, which is linear in the worst case.
+     */
+    constexpr size_t search_work_ratio = 8;
+    constexpr size_t search_work_slack = 4096;
+
+    inline bool search_too_slow(size_t work, size_t scanned) {
+        return work > scanned * search_work_ratio + search_work_slack;
+    }
+
+    /**
+     * Knuth-Morris-Pratt search of needle in [begin, end),
+     * comparing the bytes after mapping them with map.
+     *
+     * @return the first match, or nullptr
+     */
+    template <typename Map>
+    const char *search_kmp(const char *begin, const char *end, const char *needle, size_t n, Map map) {
+        std::vector<size_t> border(n + 1);
+        border[0] = 0;
+        border[1] = 0;
+        for (size_t i = 1, k = 0; i < n; ++i) {
+            while (k > 0 && map(needle[i]) != map(needle[k])) {
+                k = border[k];
+            }
+            if (map(needle[i]) == map(needle[k])) {
+                ++k;
+            }
+            border[i + 1] = k;
+        }
+
+        size_t matched = 0;
+        for (const char *p = begin; p != end; ++p) {
+            while (matched > 0 && map(*p) != map(needle[matched])) {
+                matched = border[matched];
+            }
+            if (map(*p) == map(needle[matched]) && ++matched == n) {
+                return p - n + 1;
+            }
+        }
+        return nullptr;
+    }
+
+    inline const char *search_kmp(const char *begin, const char *end, const char *needle, size_t n) {
+        return search_kmp(begin, end, needle, n, [](char c) { return c; });
+    }
+
+    /**
+     * Check every position, for haystacks too short for the other searches.
+     */
+    inline const char *search_naive(const char *begin, const char *end, const char *needle, size_t n) {
+        for (const char *stop = end - n + 1; begin < stop; ++begin) {
+            if (std::memcmp(begin, needle, n) == 0) {
+                return begin;
+            }
+        }
+        return nullptr;
+    }
+
+    /**
+     * Horspool search with a byte-sized skip table.
+     * Needles longer than 255 bytes skip at most 255 bytes, which is still
+     * correct since skipping less than allowed never misses a match.
+     */
+    inline const char *search_horspool(const char *begin, const char *end, const char *needle, size_t n) {
+        // Build the bad char heuristic table, with uint8_t to reduce cache thrashing.
+        std::uint8_t skipped[256];
+        std::uint8_t max_skip = static_cast<std::uint8_t>(std::min<size_t>(n, 255));
+        std::memset(skipped, max_skip, 256);
+        for (size_t i = 0; i != n - 1; ++i) {
+            skipped[(std::uint8_t) needle[i]] = static_cast<std::uint8_t>(std::min<size_t>(n - 1 - i, 255));
+        }
+
+        const char *start = begin;
+        const char *stop = end - n + 1;
+        auto last_needle = (std::uint8_t) needle[n - 1];
+        size_t work = 0;
+        while (start < stop) {
+            auto last = (std::uint8_t) start[n - 1];
+            if (last == last_needle) {
+                if (std::memcmp(start, needle, n - 1) == 0) {
+                    return start;
+                }
+                work += n;
+                if (search_too_slow(work, start - begin)) {
+                    return search_kmp(start, end, needle, n);
+                }
+            }
+            // Otherwise skip the appropriate number of bytes.
+            start += skipped[last];
+        }
+        return nullptr;
+    }
+
+#ifdef MOZART_SIMD_SSE2
+    /**
+     * Compare 16 positions at a time with the first and the last byte
+     * of the needle, then check the candidates with memcmp.
+     */
+    inline const char *search_sse2(const char *begin, const char *end, const char *needle, size_t n) {
+        const __m128i first = _mm_set1_epi8(needle[0]);
+        const __m128i last = _mm_set1_epi8(needle[n - 1]);
+        const char *p = begin;
+        const char *stop = end - n + 1;
+        size_t work = 0;
+
+        while (stop - p >= 16) {
+            __m128i block_first = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+            __m128i block_last = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + n - 1));
+            auto mask = static_cast<std::uint32_t>(_mm_movemask_epi8(
+                    _mm_and_si128(_mm_cmpeq_epi8(block_first, first), _mm_cmpeq_epi8(block_last, last))));
+            while (mask != 0) {
+                const char *candidate = p + count_trailing_zeros(mask);
+                if (std::memcmp(candidate + 1, needle + 1, n - 2) == 0) {
+                    return candidate;
+                }
+                work += n;
+                mask &= mask - 1;
+            }
+            if (search_too_slow(work, p - begin)) {
+                return search_kmp(p, end, needle, n);
+            }
+            p += 16;
+        }
+        return search_naive(p, end, needle, n);
+    }
+#endif
+
+#ifdef MOZART_SIMD_AVX2
+    /**
+     * The same as search_sse2(), 32 positions at a time.
+     */
+    MOZART_TARGET_AVX2
+    inline const char *search_avx2(const char *begin, const char *end, const char *needle, size_t n) {
+        const __m256i first = _mm256_set1_epi8(needle[0]);
+        const __m256i last = _mm256_set1_epi8(needle[n - 1]);
+        const char *p = begin;
+        const char *stop = end - n + 1;
+        size_t work = 0;
+
+        while (stop - p >= 32) {
+            __m256i block_first = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+            __m256i block_last = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p + n - 1));
+            auto mask = static_cast<std::uint32_t>(_mm256_movemask_epi8(
+                    _mm256_and_si256(_mm256_cmpeq_epi8(block_first, first), _mm256_cmpeq_epi8(block_last, last))));
+            while (mask != 0) {
+                const char *candidate = p + count_trailing_zeros(mask);
+                if (std::memcmp(candidate + 1, needle + 1, n - 2) == 0) {
+                    return candidate;
+                }
+                work += n;
+                mask &= mask - 1;
+            }
+            if (search_too_slow(work, p - begin)) {
+                return search_kmp(p, end, needle, n);
+            }
+            p += 32;
+        }
+        return search_sse2(p, end, needle, n);
+    }
+#endif
+
+    /**
+     * Search needle in [begin, end), using the widest instruction set
+     * the CPU supports.
+     *
+     * @param n the needle size, at least 2 and at most end - begin
+     * @return the first match, or nullptr
+     */
+    inline const char *search_substring(const char *begin, const char *end, const char *needle, size_t n) {
+        // For short haystacks fall back to the naive algorithm
+        if (end - begin < 16) {
+            return search_naive(begin, end, needle, n);
+        }
+#ifdef MOZART_SIMD_AVX2
+        if (cpu_features::get().avx2) {
+            return search_avx2(begin, end, needle, n);
+        }
+#endif
+#ifdef MOZART_SIMD_SSE2
+        return search_sse2(begin, end, needle, n);
+#else
+        return search_horspool(begin, end, needle, n);
+#endif
+    }
+
+    /**
+     * A set of bytes, kept as a bitmap for scalar lookups and as nibble
+     * tables for pshufb lookups: byte b is in the set if bit (b >> 4) & 7
+     * of nibbles[b >> 7][b & 15] is set.
+     */
+    struct byte_set {
+        std::uint64_t bits[4] = {0, 0, 0, 0};
+        alignas(16) std::uint8_t nibbles[2][16] = {};
+
+        void add(std::uint8_t b) {
+            bits[b >> 6] |= std::uint64_t(1) << (b & 63);
+            nibbles[b >> 7][b & 15] |= static_cast<std::uint8_t>(1 << ((b >> 4) & 7));
+        }
+
+        bool test(std::uint8_t b) const {
+            return ((bits[b >> 6] >> (b & 63)) & 1) != 0;
+        }
+    };
+
+    /**
+     * Whether T has a bytes() returning the byte_set it tests for.
+     */
+    template <typename T, typename = void>
+    struct has_byte_set : std::false_type {
+    };
+
+    template <typename T>
+    struct has_byte_set<T, std::enable_if_t<std::is_convertible<
+            decltype(std::declval<const T &>().bytes()), const byte_set &>::value>> : std::true_type {
+    };
+
+    /**
+     * Find the first byte in [begin, end) whose membership in the set is in_set.
+     *
+     * @return the byte found, or nullptr
+     */
+    inline const char *scan_first_scalar(const char *begin, const char *end, const byte_set &set, bool in_set) {
+        for (; begin != end; ++begin) {
+            if (set.test(static_cast<std::uint8_t>(*begin)) == in_set) {
+                return begin;
+            }
+        }
+        return nullptr;
+    }
+
+    /**
+     * Find the last byte in [begin, end) whose membership in the set is in_set.
+     *
+     * @return the byte found, or nullptr
+     */
+    inline const char *scan_last_scalar(const char *begin, const char *end, const byte_set &set, bool in_set) {
+        while (end != begin) {
+            --end;
+            if (set.test(static_cast<std::uint8_t>(*end)) == in_set) {
+                return end;
+            }
+        }
+        return nullptr;
+    }
+
+#ifdef MOZART_SIMD_SSSE3
+    /**
+     * Look up 16 bytes in the nibble tables at once.
+     *
+     * @return 0xff for the bytes in the set, 0 for the others
+     */
+    MOZART_TARGET_SSSE3
+    inline __m128i classify_ssse3(__m128i x, __m128i lower_table, __m128i upper_table, __m128i bit_table) {
+        const __m128i nibble = _mm_set1_epi8(0x0f);
+        __m128i low = _mm_and_si128(x, nibble);
+        __m128i high = _mm_and_si128(_mm_srli_epi16(x, 4), nibble);
+        // bytes >= 0x80 use the second table
+        __m128i upper = _mm_cmplt_epi8(x, _mm_setzero_si128());
+        __m128i row = _mm_or_si128(_mm_andnot_si128(upper, _mm_shuffle_epi8(lower_table, low)),
+                                   _mm_and_si128(upper, _mm_shuffle_epi8(upper_table, low)));
+        __m128i bit = _mm_shuffle_epi8(bit_table, high);
+        return _mm_cmpeq_epi8(_mm_and_si128(row, bit), bit);
+    }
+
+    MOZART_TARGET_SSSE3
+    inline const char *scan_first_ssse3(const char *begin, const char *end, const byte_set &set, bool in_set) {
+        const __m128i lower_table = _mm_load_si128(reinterpret_cast<const __m128i *>(set.nibbles[0]));
+        const __m128i upper_table = _mm_load_si128(reinterpret_cast<const __m128i *>(set.nibbles[1]));
+        const __m128i bit_table = _mm_setr_epi8(1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8, 16, 32, 64, -128);
+        const std::uint32_t flip = in_set ? 0 : 0xffff;
+
+        const char *p = begin;
+        for (; end - p >= 16; p += 16) {
+            __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+            auto mask = static_cast<std::uint32_t>(_mm_movemask_epi8(
+                    classify_ssse3(block, lower_table, upper_table, bit_table))) ^ flip;
+            if (mask != 0) {
+                return p + count_trailing_zeros(mask);
+            }
+        }
+        return scan_first_scalar(p, end, set, in_set);
+    }
+
+    MOZART_TARGET_SSSE3
+    inline const char *scan_last_ssse3(const char *begin, const char *end, const byte_set &set, bool in_set) {
+        const __m128i lower_table = _mm_load_si128(reinterpret_cast<const __m128i *>(set.nibbles[0]));
+        const __m128i upper_table = _mm_load_si128(reinterpret_cast<const __m128i *>(set.nibbles[1]));
+        const __m128i bit_table = _mm_setr_epi8(1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8, 16, 32, 64, -128);
+        const std::uint32_t flip = in_set ? 0 : 0xffff;
+
+        const char *p = end;
+        while (p - begin >= 16) {
+            p -= 16;
+            __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+            auto mask = static_cast<std::uint32_t>(_mm_movemask_epi8(
+                    classify_ssse3(block, lower_table, upper_table, bit_table))) ^ flip;
+            if (mask != 0) {
+                return p + highest_bit(mask);
+            }
+        }
+        return scan_last_scalar(begin, p, set, in_set);
+    }
+#endif
+
+#ifdef MOZART_SIMD_AVX2
+    /**
+     * The same as classify_ssse3(), 32 bytes at a time.
+     * The tables are repeated in both 128-bit lanes.
+     */
+    MOZART_TARGET_AVX2
+    inline __m256i classify_avx2(__m256i x, __m256i lower_table, __m256i upper_table, __m256i bit_table) {
+        const __m256i nibble = _mm256_set1_epi8(0x0f);
+        __m256i low = _mm256_and_si256(x, nibble);
+        __m256i high = _mm256_and_si256(_mm256_srli_epi16(x, 4), nibble);
+        __m256i upper = _mm256_cmpgt_epi8(_mm256_setzero_si256(), x);
+        __m256i row = _mm256_blendv_epi8(_mm256_shuffle_epi8(lower_table, low),
+                                         _mm256_shuffle_epi8(upper_table, low), upper);
+        __m256i bit = _mm256_shuffle_epi8(bit_table, high);
+        return _mm256_cmpeq_epi8(_mm256_and_si256(row, bit), bit);
+    }
+
+    MOZART_TARGET_AVX2
+    inline const char *scan_first_avx2(const char *begin, const char *end, const byte_set &set, bool in_set) {
+        const __m256i lower_table = _mm256_broadcastsi128_si256(
+                _mm_load_si128(reinterpret_cast<const __m128i *>(set.nibbles[0])));
+        const __m256i upper_table = _mm256_broadcastsi128_si256(
+                _mm_load_si128(reinterpret_cast<const __m128i *>(set.nibbles[1])));
+        const __m256i bit_table = _mm256_setr_epi8(1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8, 16, 32, 64, -128,
+                                                   1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8, 16, 32, 64, -128);
+        const std::uint32_t flip = in_set ? 0 : 0xffffffff;
+
+        const char *p = begin;
+        for (; end - p >= 32; p += 32) {
+            __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+            auto mask = static_cast<std::uint32_t>(_mm256_movemask_epi8(
+                    classify_avx2(block, lower_table, upper_table, bit_table))) ^ flip;
+            if (mask != 0) {
+                return p + count_trailing_zeros(mask);
+            }
+        }
+        return scan_first_ssse3(p, end, set, in_set);
+    }
+
+    MOZART_TARGET_AVX2
+    inline const char *scan_last_avx2(const char *begin, const char *end, const byte_set &set, bool in_set) {
+        const __m256i lower_table = _mm256_broadcastsi128_si256(
+                _mm_load_si128(reinterpret_cast<const __m128i *>(set.nibbles[0])));
+        const __m256i upper_table = _mm256_broadcastsi128_si256(
+                _mm_load_si128(reinterpret_cast<const __m128i *>(set.nibbles[1])));
+        const __m256i bit_table = _mm256_setr_epi8(1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8, 16, 32, 64, -128,
+                                                   1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8, 16, 32, 64, -128);
+        const std::uint32_t flip = in_set ? 0 : 0xffffffff;
+
+        const char *p = end;
+        while (p - begin >= 32) {
+            p -= 32;
+            __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+            auto mask = static_cast<std::uint32_t>(_mm256_movemask_epi8(
+                    classify_avx2(block, lower_table, upper_table, bit_table))) ^ flip;
+            if (mask != 0) {
+                return p + highest_bit(mask);
+            }
+        }
+        return scan_last_ssse3(begin, p, set, in_set);
+    }
+#endif
+
+    /**
+     * Find the first byte in [begin, end) whose membership in the set is in_set,
+     * using the widest instruction set the CPU supports.
+     *
+     * @return the byte found, or nullptr
+     */
+    inline const char *scan_first(const char *begin, const char *end, const byte_set &set, bool in_set) {
+        if (end - begin >= 16) {
+#ifdef MOZART_SIMD_AVX2
+            if (cpu_features::get().avx2) {
+                return scan_first_avx2(begin, end, set, in_set);
+            }
+#endif
+#ifdef MOZART_SIMD_SSSE3
+            if (cpu_features::get().ssse3) {
+                return scan_first_ssse3(begin, end, set, in_set);
+            }
+#endif
+        }
+        return scan_first_scalar(begin, end, set, in_set);
+    }
+
+    /**
+     * Find the last byte in [begin, end) whose membership in the set is in_set,
+     * using the widest instruction set the CPU supports.
+     *
+     * @return the byte found, or nullptr
+     */
+    inline const char *scan_last(const char *begin, const char *end, const byte_set &set, bool in_set) {
+        if (end - begin >= 16) {
+#ifdef MOZART_SIMD_AVX2
+            if (cpu_features::get().avx2) {
+                return scan_last_avx2(begin, end, set, in_set);
+            }
+#endif
+#ifdef MOZART_SIMD_SSSE3
+            if (cpu_features::get().ssse3) {
+                return scan_last_ssse3(begin, end, set, in_set);
+            }
+#endif
+        }
+        return scan_last_scalar(begin, end, set, in_set);
+    }
+
+    /**
+     * Lower an ASCII letter, leave other bytes as they are.
+     * Unlike std::tolower, this does not depend on the locale.
+     */
+    inline std::uint8_t ascii_fold(std::uint8_t c) {
+        return static_cast<std::uint8_t>(c | (static_cast<unsigned>(c - 'A') < 26u) << 5);
+    }
+
+    inline int compare_ignore_case_scalar(const char *lhs, const char *rhs, size_t length) {
+        for (size_t index = 0; index < length; ++index) {
+            std::uint8_t lw = ascii_fold(static_cast<std::uint8_t>(lhs[index]));
+            std::uint8_t rw = ascii_fold(static_cast<std::uint8_t>(rhs[index]));
+            if (lw != rw) {
+                return lw < rw ? -1 : 1;
+            }
+        }
+        return 0;
+    }
+
+#ifdef MOZART_SIMD_SSE2
+    /**
+     * Lower the ASCII letters in 16 bytes at once.
+     */
+    inline __m128i ascii_fold_sse2(__m128i x) {
+        // move ['A', 'Z'] to [-128, -103] for the signed compare
+        __m128i shifted = _mm_sub_epi8(x, _mm_set1_epi8(static_cast<char>('A' + 128)));
+        __m128i upper = _mm_cmplt_epi8(shifted, _mm_set1_epi8(-128 + 26));
+        return _mm_or_si128(x, _mm_and_si128(upper, _mm_set1_epi8(0x20)));
+    }
+#endif
+
+    /**
+     * Compare two byte arrays case insensitively, ASCII letters only.
+     *
+     * @return -1, 0 or 1
+     */
+    inline int compare_ignore_case(const char *lhs, const char *rhs, size_t length) {
+        size_t index = 0;
+#ifdef MOZART_SIMD_SSE2
+        for (; length - index >= 16; index += 16) {
+            __m128i l = ascii_fold_sse2(_mm_loadu_si128(reinterpret_cast<const __m128i *>(lhs + index)));
+            __m128i r = ascii_fold_sse2(_mm_loadu_si128(reinterpret_cast<const __m128i *>(rhs + index)));
+            auto mask = static_cast<std::uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(l, r))) ^ 0xffff;
+            if (mask != 0) {
+                index += count_trailing_zeros(mask);
+                return compare_ignore_case_scalar(lhs + index, rhs + index, 1);
+            }
+        }
+#endif
+        return compare_ignore_case_scalar(lhs + index, rhs + index, length - index);
+    }
+
+    inline const char *search_naive_ignore_case(const char *begin, const char *end, const char *needle, size_t n) {
+        for (const char *stop = end - n + 1; begin < stop; ++begin) {
+            if (compare_ignore_case(begin, needle, n) == 0) {
+                return begin;
+            }
+        }
+        return nullptr;
+    }
+
+    inline const char *search_kmp_ignore_case(const char *begin, const char *end, const char *needle, size_t n) {
+        return search_kmp(begin, end, needle, n, [](char c) {
+            return ascii_fold(static_cast<std::uint8_t>(c));
+        });
+    }
+
+    /**
+     * search_horspool() with the skip table indexed by lowered bytes.
+     */
+    inline const char *search_horspool_ignore_case(const char *begin, const char *end, const char *needle, size_t n) {
+        std::uint8_t skipped[256];
+        std::uint8_t max_skip = static_cast<std::uint8_t>(std::min<size_t>(n, 255));
+        std::memset(skipped, max_skip, 256);
+        for (size_t i = 0; i != n - 1; ++i) {
+            skipped[ascii_fold(static_cast<std::uint8_t>(needle[i]))] =
+                    static_cast<std::uint8_t>(std::min<size_t>(n - 1 - i, 255));
+        }
+
+        const char *start = begin;
+        const char *stop = end - n + 1;
+        std::uint8_t last_needle = ascii_fold(static_cast<std::uint8_t>(needle[n - 1]));
+        size_t work = 0;
+        while (start < stop) {
+            std::uint8_t last = ascii_fold(static_cast<std::uint8_t>(start[n - 1]));
+            if (last == last_needle) {
+                if (compare_ignore_case(start, needle, n - 1) == 0) {
+                    return start;
+                }
+                work += n;
+                if (search_too_slow(work, start - begin)) {
+                    return search_kmp_ignore_case(start, end, needle, n);
+                }
+            }
+            start += skipped[last];
+        }
+        return nullptr;
+    }
+
+#ifdef MOZART_SIMD_SSE2
+    /**
+     * search_sse2() comparing the lowered bytes.
+     */
+    inline const char *search_sse2_ignore_case(const char *begin, const char *end, const char *needle, size_t n) {
+        const __m128i first = _mm_set1_epi8(static_cast<char>(ascii_fold(static_cast<std::uint8_t>(needle[0]))));
+        const __m128i last = _mm_set1_epi8(static_cast<char>(ascii_fold(static_cast<std::uint8_t>(needle[n - 1]))));
+        const char *p = begin;
+        const char *stop = end - n + 1;
+        size_t work = 0;
+
+        while (stop - p >= 16) {
+            __m128i block_first = ascii_fold_sse2(_mm_loadu_si128(reinterpret_cast<const __m128i *>(p)));
+            __m128i block_last = ascii_fold_sse2(_mm_loadu_si128(reinterpret_cast<const __m128i *>(p + n - 1)));
+            auto mask = static_cast<std::uint32_t>(_mm_movemask_epi8(
+                    _mm_and_si128(_mm_cmpeq_epi8(block_first, first), _mm_cmpeq_epi8(block_last, last))));
+            while (mask != 0) {
+                const char *candidate = p + count_trailing_zeros(mask);
+                if (compare_ignore_case(candidate + 1, needle + 1, n - 2) == 0) {
+                    return candidate;
+                }
+                work += n;
+                mask &= mask - 1;
+            }
+            if (search_too_slow(work, p - begin)) {
+                return search_kmp_ignore_case(p, end, needle, n);
+            }
+            p += 16;
+        }
+        return search_naive_ignore_case(p, end, needle, n);
+    }
+#endif
+
+    /**
+     * Search needle in [begin, end) case insensitively, ASCII letters only.
+     *
+     * @param n the needle size, at least 2 and at most end - begin
+     * @return the first match, or nullptr
+     */
+    inline const char *search_substring_ignore_case(const char *begin, const char *end, const char *needle, size_t n) {
+        if (end - begin < 16) {
+            return search_naive_ignore_case(begin, end, needle, n);
+        }
+#ifdef MOZART_SIMD_SSE2
+        return search_sse2_ignore_case(begin, end, needle, n);
+#else
+        return search_horspool_ignore_case(begin, end, needle, n);
+#endif
+    }
+
+    /**
+     * A filter for the positions where any of a set of patterns may start,
+     * in the style of Hyperscan's Teddy. The patterns are spread over 8
+     * buckets, and a position passes if, for some bucket, each of its first
+     * width bytes (1 to 3) is the corresponding byte of a pattern in that
+     * bucket. Every byte is looked up by its two nibbles, so the SIMD scan
+     * tests 16 positions with a few pshufb.
+     *
+     * The filter never rejects a position where a pattern of at least
+     * width bytes starts.
+     */
+    struct prefix_filter {
+        static constexpr size_t max_width = 3;
+
+        alignas(16) std::uint8_t low[max_width][16] = {};
+        alignas(16) std::uint8_t high[max_width][16] = {};
+        size_t width = 1;
+
+        void add(size_t k, std::uint8_t b, unsigned bucket) {
+            low[k][b & 15] |= static_cast<std::uint8_t>(1 << bucket);
+            high[k][b >> 4] |= static_cast<std::uint8_t>(1 << bucket);
+        }
+
+        std::uint8_t test(size_t k, std::uint8_t b) const {
+            return static_cast<std::uint8_t>(low[k][b & 15] & high[k][b >> 4]);
+        }
+    };
+
+    /**
+     * Find the first position in [begin, end) passing the filter.
+     *
+     * @return the position, or nullptr
+     */
+    inline const char *scan_prefix_scalar(const char *begin, const char *end, const prefix_filter &filter) {
+        for (; static_cast<size_t>(end - begin) >= filter.width; ++begin) {
+            std::uint8_t buckets = 0xff;
+            for (size_t k = 0; k != filter.width; ++k) {
+                buckets &= filter.test(k, static_cast<std::uint8_t>(begin[k]));
+            }
+            if (buckets != 0) {
+                return begin;
+            }
+        }
+        return nullptr;
+    }
+
+#ifdef MOZART_SIMD_SSSE3
+    MOZART_TARGET_SSSE3
+    inline const char *scan_prefix_ssse3(const char *begin, const char *end, const prefix_filter &filter) {
+        const __m128i nibble = _mm_set1_epi8(0x0f);
+        __m128i low[prefix_filter::max_width];
+        __m128i high[prefix_filter::max_width];
+        for (size_t k = 0; k != filter.width; ++k) {
+            low[k] = _mm_load_si128(reinterpret_cast<const __m128i *>(filter.low[k]));
+            high[k] = _mm_load_si128(reinterpret_cast<const __m128i *>(filter.high[k]));
+        }
+
+        const char *p = begin;
+        for (; static_cast<size_t>(end - p) >= 16 + filter.width - 1; p += 16) {
+            __m128i buckets = _mm_set1_epi8(-1);
+            for (size_t k = 0; k != filter.width; ++k) {
+                __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + k));
+                __m128i lo = _mm_and_si128(block, nibble);
+                __m128i hi = _mm_and_si128(_mm_srli_epi16(block, 4), nibble);
+                buckets = _mm_and_si128(buckets, _mm_and_si128(_mm_shuffle_epi8(low[k], lo),
+                                                               _mm_shuffle_epi8(high[k], hi)));
+            }
+            auto mask = static_cast<std::uint32_t>(_mm_movemask_epi8(
+                    _mm_cmpeq_epi8(buckets, _mm_setzero_si128()))) ^ 0xffff;
+            if (mask != 0) {
+                return p + count_trailing_zeros(mask);
+            }
+        }
+        return scan_prefix_scalar(p, end, filter);
+    }
+#endif
+
+#ifdef MOZART_SIMD_AVX2
+    /**
+     * The same as scan_prefix_ssse3(), 32 positions at a time.
+     */
+    MOZART_TARGET_AVX2
+    inline const char *scan_prefix_avx2(const char *begin, const char *end, const prefix_filter &filter) {
+        const __m256i nibble = _mm256_set1_epi8(0x0f);
+        __m256i low[prefix_filter::max_width];
+        __m256i high[prefix_filter::max_width];
+        for (size_t k = 0; k != filter.width; ++k) {
+            low[k] = _mm256_broadcastsi128_si256(_mm_load_si128(reinterpret_cast<const __m128i *>(filter.low[k])));
+            high[k] = _mm256_broadcastsi128_si256(_mm_load_si128(reinterpret_cast<const __m128i *>(filter.high[k])));
+        }
+
+        const char *p = begin;
+        for (; static_cast<size_t>(end - p) >= 32 + filter.width - 1; p += 32) {
+            __m256i buckets = _mm256_set1_epi8(-1);
+            for (size_t k = 0; k != filter.width; ++k) {
+                __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p + k));
+                __m256i lo = _mm256_and_si256(block, nibble);
+                __m256i hi = _mm256_and_si256(_mm256_srli_epi16(block, 4), nibble);
+                buckets = _mm256_and_si256(buckets, _mm256_and_si256(_mm256_shuffle_epi8(low[k], lo),
+                                                                     _mm256_shuffle_epi8(high[k], hi)));
+            }
+            auto mask = static_cast<std::uint32_t>(_mm256_movemask_epi8(
+                    _mm256_cmpeq_epi8(buckets, _mm256_setzero_si256()))) ^ 0xffffffff;
+            if (mask != 0) {
+                return p + count_trailing_zeros(mask);
+            }
+        }
+        return scan_prefix_ssse3(p, end, filter);
+    }
+#endif
+
+    /**
+     * Find the first position in [begin, end) passing the filter,
+     * using the widest instruction set the CPU supports.
+     *
+     * @return the position, or nullptr
+     */
+    inline const char *scan_prefix(const char *begin, const char *end, const prefix_filter &filter) {
+#ifdef MOZART_SIMD_AVX2
+        if (cpu_features::get().avx2) {
+            return scan_prefix_avx2(begin, end, filter);
+        }
+#endif
+#ifdef MOZART_SIMD_SSSE3
+        if (cpu_features::get().ssse3) {
+            return scan_prefix_ssse3(begin, end, filter);
+        }
+#endif
+        return scan_prefix_scalar(begin, end, filter);
+    }
+
+    inline size_t count_byte_scalar(const char *begin, const char *end, char c) {
+        size_t count = 0;
+        for (; begin != end; ++begin) {
+            count += *begin == c ? 1 : 0;
+        }
+        return count;
+    }
+
+#ifdef MOZART_SIMD_SSE2
+    /**
+     * Count the bytes equal to c, 16 at a time. Each compare mask
+     * (-1 per match) is subtracted from byte counters, which are summed
+     * with psadbw before they can overflow.
+     */
+    inline size_t count_byte_sse2(const char *begin, const char *end, char c) {
+        const __m128i needle = _mm_set1_epi8(c);
+        const __m128i zero = _mm_setzero_si128();
+        size_t count = 0;
+        const char *p = begin;
+        while (end - p >= 16) {
+            // at most 255 blocks before the byte counters overflow
+            size_t blocks = std::min<size_t>(static_cast<size_t>(end - p) / 16, 255);
+            __m128i counters = zero;
+            for (size_t i = 0; i != blocks; ++i, p += 16) {
+                __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+                counters = _mm_sub_epi8(counters, _mm_cmpeq_epi8(block, needle));
+            }
+            __m128i sums = _mm_sad_epu8(counters, zero);
+            count += static_cast<size_t>(_mm_cvtsi128_si32(sums)) + static_cast<size_t>(_mm_extract_epi16(sums, 4));
+        }
+        return count + count_byte_scalar(p, end, c);
+    }
+#endif
+
+#ifdef MOZART_SIMD_AVX2
+    /**
+     * The same as count_byte_sse2(), 32 bytes at a time.
+     */
+    MOZART_TARGET_AVX2
+    inline size_t count_byte_avx2(const char *begin, const char *end, char c) {
+        const __m256i needle = _mm256_set1_epi8(c);
+        const __m256i zero = _mm256_setzero_si256();
+        size_t count = 0;
+        const char *p = begin;
+        while (end - p >= 32) {
+            size_t blocks = std::min<size_t>(static_cast<size_t>(end - p) / 32, 255);
+            __m256i counters = zero;
+            for (size_t i = 0; i != blocks; ++i, p += 32) {
+                __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+                counters = _mm256_sub_epi8(counters, _mm256_cmpeq_epi8(block, needle));
+            }
+            __m256i sums = _mm256_sad_epu8(counters, zero);
+            __m128i half = _mm_add_epi64(_mm256_castsi256_si128(sums), _mm256_extracti128_si256(sums, 1));
+            count += static_cast<size_t>(_mm_cvtsi128_si32(half)) + static_cast<size_t>(_mm_extract_epi16(half, 4));
+        }
+        return count + count_byte_sse2(p, end, c);
+    }
+#endif
+
+    /**
+     * Count the bytes equal to c in [begin, end), using the widest
+     * instruction set the CPU supports.
+     */
+    inline size_t count_byte(const char *begin, const char *end, char c) {
+#ifdef MOZART_SIMD_AVX2
+        if (cpu_features::get().avx2) {
+            return count_byte_avx2(begin, end, c);
+        }
+#endif
+#ifdef MOZART_SIMD_SSE2
+        return count_byte_sse2(begin, end, c);
+#else
+        return count_byte_scalar(begin, end, c);
+#endif
+    }
+
+    /**
+     * Knuth-Morris-Pratt counting of needle in [begin, end).
+     *
+     * @param overlapping true to count matches overlapping each other
+     */
+    inline size_t count_kmp(const char *begin, const char *end, const char *needle, size_t n, bool overlapping) {
+        std::vector<size_t> border(n + 1);
+        border[0] = 0;
+        border[1] = 0;
+        for (size_t i = 1, k = 0; i < n; ++i) {
+            while (k > 0 && needle[i] != needle[k]) {
+                k = border[k];
+            }
+            if (needle[i] == needle[k]) {
+                ++k;
+            }
+            border[i + 1] = k;
+        }
+
+        size_t count = 0;
+        size_t matched = 0;
+        for (const char *p = begin; p != end; ++p) {
+            while (matched > 0 && *p != needle[matched]) {
+                matched = border[matched];
+            }
+            if (*p == needle[matched] && ++matched == n) {
+                ++count;
+                matched = overlapping ? border[n] : 0;
+            }
+        }
+        return count;
+    }
+
+    /**
+     * Count needle in [begin, end) with search_substring(). When the matches
+     * are so dense that checking them costs more than this many bytes per
+     * byte scanned, e.g. "aa" in "aaaa...", the rest is counted with
+     * Knuth-Morris-Pratt, so the counting is linear in the worst case.
+     *
+     * @param n the needle size, at least 2
+     * @param overlapping true to count matches overlapping each other
+     */
+    inline size_t count_substring(const char *begin, const char *end, const char *needle, size_t n, bool overlapping) {
+        size_t count = 0;
+        const char *p = begin;
+        while (end - p >= static_cast<std::ptrdiff_t>(n)) {
+            const char *found = search_substring(p, end, needle, n);
+            if (found == nullptr) {
+                break;
+            }
+            ++count;
+            p = overlapping ? found + 1 : found + n;
+            if (search_too_slow(count * n, found - begin)) {
+                return count + count_kmp(p, end, needle, n, overlapping);
+            }
+        }
+        return count;
+    }
+
+    /**
+     * Flip the case of the ASCII letters in [first, first + 26),
+     * i.e. lower them if first is 'A' or upper them if first is 'a'.
+     * src and dst may be the same for an in-place conversion.
+     */
+    inline void change_case_scalar(const char *src, char *dst, size_t length, char first) {
+        for (size_t i = 0; i != length; ++i) {
+            char c = src[i];
+            dst[i] = static_cast<char>(c ^ (static_cast<unsigned char>(c - first) < 26u) << 5);
+        }
+    }
+
+#ifdef MOZART_SIMD_SSE2
+    inline void change_case_sse2(const char *src, char *dst, size_t length, char first) {
+        // move [first, first + 26) to [-128, -103] for the signed compare
+        const __m128i offset = _mm_set1_epi8(static_cast<char>(first + 128));
+        const __m128i limit = _mm_set1_epi8(-128 + 26);
+        const __m128i flip = _mm_set1_epi8(0x20);
+        size_t i = 0;
+        for (; length - i >= 16; i += 16) {
+            __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+            __m128i letters = _mm_cmplt_epi8(_mm_sub_epi8(x, offset), limit);
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), _mm_xor_si128(x, _mm_and_si128(letters, flip)));
+        }
+        change_case_scalar(src + i, dst + i, length - i, first);
+    }
+#endif
+
+#ifdef MOZART_SIMD_AVX2
+    MOZART_TARGET_AVX2
+    inline void change_case_avx2(const char *src, char *dst, size_t length, char first) {
+        const __m256i offset = _mm256_set1_epi8(static_cast<char>(first + 128));
+        const __m256i limit = _mm256_set1_epi8(-128 + 26);
+        const __m256i flip = _mm256_set1_epi8(0x20);
+        size_t i = 0;
+        for (; length - i >= 32; i += 32) {
+            __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + i));
+            __m256i letters = _mm256_cmpgt_epi8(limit, _mm256_sub_epi8(x, offset));
+            _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i),
+                                _mm256_xor_si256(x, _mm256_and_si256(letters, flip)));
+        }
+        change_case_sse2(src + i, dst + i, length - i, first);
+    }
+#endif
+
+    /**
+     * Lower ('A') or upper ('a') the ASCII letters of src into dst, using
+     * the widest instruction set the CPU supports.
+     */
+    inline void change_case(const char *src, char *dst, size_t length, char first) {
+#ifdef MOZART_SIMD_AVX2
+        if (length >= 32 && cpu_features::get().avx2) {
+            change_case_avx2(src, dst, length, first);
+            return;
+        }
+#endif
+#ifdef MOZART_SIMD_SSE2
+        change_case_sse2(src, dst, length, first);
+#else
+        change_case_scalar(src, dst, length, first);
+#endif
+    }
+}
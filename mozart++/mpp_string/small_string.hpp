@@ -0,0 +1,315 @@
+/**
+ * Mozart++ Template Library: String/Small String
+ * Licensed under Apache 2.0
+ * Copyright (C) 2020-2021 Chengdu Covariant Technologies Co., LTD.
+ * Website: https://covariant.cn/
+ * Github:  https://github.com/chengdu-zhirui/
+ */
+
+#pragma once
+
+#include <mozart++/memory>
+#include "string.hpp"
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <string>
+
+namespace mpp {
+    /**
+     * An owning string that keeps up to N chars inside the object and only
+     * spills to memory from allocator_t when it grows past that, doubling
+     * its capacity each time it has to grow again.
+     *
+     * The data is always NUL-terminated, and converts to string_ref without
+     * copying, so every string_ref operation applies to it. Moving never
+     * allocates: a heap buffer is handed over, inline chars are copied.
+     *
+     * @tparam N: Inline Capacity, in chars
+     * @tparam allocator_t: Standard Allocator Implementation, as in allocator_type
+     */
+    template <size_t N = 23, template <typename> class allocator_t = allocator>
+    class small_string {
+    public:
+        static constexpr size_t npos = string_ref::npos;
+        static constexpr size_t inline_capacity = N;
+
+        using iterator = char *;
+        using const_iterator = const char *;
+        using size_type = size_t;
+        using allocator_traits = std::allocator_traits<allocator_t<char>>;
+
+    private:
+        allocator_t<char> _alloc;
+        char *_data = _inline;
+        size_t _size = 0;
+        size_t _capacity = N;
+        char _inline[N + 1] = {};
+
+        bool heap() const {
+            return _data != _inline;
+        }
+
+        void free_heap() {
+            if (heap()) {
+                allocator_traits::deallocate(_alloc, _data, _capacity + 1);
+                _data = _inline;
+                _capacity = N;
+            }
+        }
+
+        /**
+         * Grow the buffer to hold at least capacity chars, keeping the contents.
+         */
+        void grow(size_t capacity) {
+            if (capacity > allocator_traits::max_size(_alloc) - 1) {
+                mpp::throw_ex<mpp::runtime_error>("small_string: length exceeds max_size()");
+            }
+            capacity = std::max(capacity, _capacity * 2);
+            char *data = allocator_traits::allocate(_alloc, capacity + 1);
+            std::memcpy(data, _data, _size + 1);
+            free_heap();
+            _data = data;
+            _capacity = capacity;
+        }
+
+        /**
+         * Take other's contents, leaving it empty. Never allocates.
+         */
+        void steal(small_string &other) noexcept {
+            if (other.heap()) {
+                _data = other._data;
+                _capacity = other._capacity;
+                other._data = other._inline;
+                other._capacity = N;
+            } else {
+                std::memcpy(_inline, other._inline, other._size + 1);
+            }
+            _size = other._size;
+            other._size = 0;
+            other._inline[0] = '\0';
+        }
+
+    public:
+        small_string() = default;
+
+        /*implicit*/ small_string(string_ref str) {
+            assign(str);
+        }
+
+        /*implicit*/ small_string(const char *str)
+                : small_string(string_ref(str)) {}
+
+        small_string(const char *data, size_t length)
+                : small_string(string_ref(data, length)) {}
+
+        small_string(size_t count, char c) {
+            resize(count, c);
+        }
+
+        small_string(const small_string &other)
+                : _alloc(allocator_traits::select_on_container_copy_construction(other._alloc)) {
+            assign(other.ref());
+        }
+
+        small_string(small_string &&other) noexcept
+                : _alloc(std::move(other._alloc)) {
+            steal(other);
+        }
+
+        ~small_string() {
+            free_heap();
+        }
+
+        small_string &operator=(const small_string &other) {
+            if (this != &other) {
+                assign(other.ref());
+            }
+            return *this;
+        }
+
+        small_string &operator=(small_string &&other) noexcept {
+            if (this != &other) {
+                free_heap();
+                _alloc = std::move(other._alloc);
+                steal(other);
+            }
+            return *this;
+        }
+
+        small_string &operator=(string_ref str) {
+            return assign(str);
+        }
+
+        small_string &assign(string_ref str) {
+            if (str.size() > _capacity) {
+                _size = 0;
+                grow(str.size());
+            }
+            // str may point into this string
+            std::memmove(_data, str.data(), str.size());
+            _size = str.size();
+            _data[_size] = '\0';
+            return *this;
+        }
+
+        /**
+         * Zero-cost view of the contents.
+         */
+        string_ref ref() const {
+            return string_ref(_data, _size);
+        }
+
+        /*implicit*/ operator string_ref() const {
+            return ref();
+        }
+
+        std::string str() const {
+            return std::string(_data, _size);
+        }
+
+        char *data() { return _data; }
+
+        const char *data() const { return _data; }
+
+        const char *c_str() const { return _data; }
+
+        size_t size() const { return _size; }
+
+        size_t length() const { return _size; }
+
+        size_t capacity() const { return _capacity; }
+
+        bool empty() const { return _size == 0; }
+
+        /**
+         * Whether the chars are stored inside the object.
+         */
+        bool is_inline() const { return !heap(); }
+
+        iterator begin() { return _data; }
+
+        iterator end() { return _data + _size; }
+
+        const_iterator begin() const { return _data; }
+
+        const_iterator end() const { return _data + _size; }
+
+        char &operator[](size_t index) {
+            if (index >= _size) {
+                mpp::throw_ex<mpp::runtime_error>("small_string: invalid index");
+            }
+            return _data[index];
+        }
+
+        char operator[](size_t index) const {
+            if (index >= _size) {
+                mpp::throw_ex<mpp::runtime_error>("small_string: invalid index");
+            }
+            return _data[index];
+        }
+
+        void reserve(size_t capacity) {
+            if (capacity > _capacity) {
+                grow(capacity);
+            }
+        }
+
+        void resize(size_t size, char c = '\0') {
+            reserve(size);
+            if (size > _size) {
+                std::memset(_data + _size, c, size - _size);
+            }
+            _size = size;
+            _data[_size] = '\0';
+        }
+
+        void clear() {
+            _size = 0;
+            _data[0] = '\0';
+        }
+
+        /**
+         * Move the contents back inside the object if they fit,
+         * and release the heap buffer.
+         */
+        void shrink_to_fit() {
+            if (heap() && _size <= N) {
+                std::memcpy(_inline, _data, _size + 1);
+                free_heap();
+            }
+        }
+
+        void push_back(char c) {
+            if (_size == _capacity) {
+                grow(_size + 1);
+            }
+            _data[_size++] = c;
+            _data[_size] = '\0';
+        }
+
+        void pop_back() {
+            if (empty()) {
+                mpp::throw_ex<mpp::runtime_error>("small_string: pop_back() on empty string");
+            }
+            _data[--_size] = '\0';
+        }
+
+        small_string &append(string_ref str) {
+            if (str.size() > _capacity - _size) {
+                // str may point into this string
+                const char *old = _data;
+                bool self = std::less_equal<const char *>()(old, str.data()) &&
+                            std::less<const char *>()(str.data(), old + _size);
+                size_t offset = self ? str.data() - old : 0;
+                grow(_size + str.size());
+                if (self) {
+                    str = string_ref(_data + offset, str.size());
+                }
+            }
+            std::memmove(_data + _size, str.data(), str.size());
+            _size += str.size();
+            _data[_size] = '\0';
+            return *this;
+        }
+
+        small_string &operator+=(string_ref str) {
+            return append(str);
+        }
+
+        small_string &operator+=(char c) {
+            push_back(c);
+            return *this;
+        }
+
+        void swap(small_string &other) noexcept {
+            small_string tmp(std::move(other));
+            other = std::move(*this);
+            *this = std::move(tmp);
+        }
+    };
+
+    template <size_t N, template <typename> class allocator_t>
+    inline std::ostream &operator<<(std::ostream &out, const small_string<N, allocator_t> &str) {
+        return out << str.ref();
+    }
+
+    template <size_t N, template <typename> class allocator_t>
+    inline void lower_in_place(small_string<N, allocator_t> &str) {
+        lower_in_place(str.data(), str.size());
+    }
+
+    template <size_t N, template <typename> class allocator_t>
+    inline void upper_in_place(small_string<N, allocator_t> &str) {
+        upper_in_place(str.data(), str.size());
+    }
+}
+
+namespace std {
+    template <size_t N, template <typename> class allocator_t>
+    struct hash<mpp::small_string<N, allocator_t>> {
+        size_t operator()(const mpp::small_string<N, allocator_t> &str) const noexcept {
+            return str.ref().hash();
+        }
+    };
+}
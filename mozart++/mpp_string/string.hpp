@@ -11,15 +11,143 @@
 #include <mozart++/core>
 #include <mozart++/stream>
 #include <mozart++/iterator_range>
+#include "simd.hpp"
 #include <algorithm>
 #include <climits>
+#include <cstdint>
 #include <cstring>
 #include <string>
 #include <vector>
-#include <bitset>
+#include <iterator>
 #include <cstdio>
+#include <ostream>
 
 namespace mpp {
+    /**
+     * A set of characters prepared once for repeated scanning, e.g. by
+     * string_ref::find_first_of() or string_ref::trim(). The scanning
+     * looks up 16 or 32 characters at a time when the CPU supports it.
+     */
+    class char_set {
+    private:
+        mpp_impl::byte_set _set;
+
+    public:
+        char_set() = default;
+
+        explicit char_set(const char *chars)
+                : char_set(chars, std::char_traits<char>::length(chars)) {}
+
+        char_set(const char *chars, size_t length) {
+            for (size_t i = 0; i != length; ++i) {
+                add(chars[i]);
+            }
+        }
+
+        explicit char_set(const std::string &chars)
+                : char_set(chars.data(), chars.size()) {}
+
+        /**
+         * The characters trimmed by default, i.e. " \t\n\v\f\r".
+         *
+         * @return the shared instance
+         */
+        static const char_set &whitespace() {
+            static const char_set set(" \t\n\v\f\r");
+            return set;
+        }
+
+        char_set &add(char c) {
+            _set.add(static_cast<unsigned char>(c));
+            return *this;
+        }
+
+        bool contains(char c) const {
+            return _set.test(static_cast<unsigned char>(c));
+        }
+
+        bool operator()(char c) const {
+            return contains(c);
+        }
+
+        const mpp_impl::byte_set &bytes() const {
+            return _set;
+        }
+    };
+
+    /**
+     * ASCII character classes, usable as predicates of string_ref::find_if()
+     * and the like, which scan 16 or 32 characters at a time for them.
+     * Unlike std::isdigit and friends, they do not depend on the locale.
+     */
+    template <typename Class>
+    struct ascii_class {
+        /**
+         * @return the bytes in the class
+         */
+        static const mpp_impl::byte_set &bytes() {
+            static const mpp_impl::byte_set set = [] {
+                mpp_impl::byte_set result;
+                for (unsigned b = 0; b != 256; ++b) {
+                    if (Class()(static_cast<char>(b))) {
+                        result.add(static_cast<std::uint8_t>(b));
+                    }
+                }
+                return result;
+            }();
+            return set;
+        }
+    };
+
+    struct ascii_digit : ascii_class<ascii_digit> {
+        bool operator()(char c) const {
+            return static_cast<unsigned char>(c - '0') < 10;
+        }
+    };
+
+    struct ascii_xdigit : ascii_class<ascii_xdigit> {
+        bool operator()(char c) const {
+            return static_cast<unsigned char>(c - '0') < 10
+                   || static_cast<unsigned char>((c | 0x20) - 'a') < 6;
+        }
+    };
+
+    struct ascii_upper : ascii_class<ascii_upper> {
+        bool operator()(char c) const {
+            return static_cast<unsigned char>(c - 'A') < 26;
+        }
+    };
+
+    struct ascii_lower : ascii_class<ascii_lower> {
+        bool operator()(char c) const {
+            return static_cast<unsigned char>(c - 'a') < 26;
+        }
+    };
+
+    struct ascii_alpha : ascii_class<ascii_alpha> {
+        bool operator()(char c) const {
+            return static_cast<unsigned char>((c | 0x20) - 'a') < 26;
+        }
+    };
+
+    struct ascii_alnum : ascii_class<ascii_alnum> {
+        bool operator()(char c) const {
+            return ascii_alpha()(c) || ascii_digit()(c);
+        }
+    };
+
+    /**
+     * " \t\n\v\f\r", the same as std::isspace in the "C" locale.
+     */
+    struct ascii_space : ascii_class<ascii_space> {
+        bool operator()(char c) const {
+            return c == ' ' || static_cast<unsigned char>(c - '\t') < 5;
+        }
+    };
+
+    template <typename Separator>
+    class split_range;
+
     /**
      * Represent a constant reference to a string, i.e. a character
      * array and a length, which need not be null terminated.
@@ -62,6 +190,26 @@ namespace mpp {
             return ::memcmp(lhs, rhs, length);
         }
 
+        static bool is_digit(char c) {
+            return c >= '0' && c <= '9';
+        }
+
+        /**
+         * Append n so that comparing the bytes compares the values:
+         * the count of significant bytes, then the bytes, big-endian.
+         */
+        static void append_ordered_size(std::string &out, size_t n) {
+            char bytes[sizeof(size_t)];
+            size_t count = 0;
+            for (; n != 0; n >>= 8) {
+                bytes[count++] = static_cast<char>(n & 0xff);
+            }
+            out.push_back(static_cast<char>(count));
+            while (count != 0) {
+                out.push_back(bytes[--count]);
+            }
+        }
+
         /**
          * Constexpr version of std::strlen.
          */
@@ -69,15 +217,39 @@ namespace mpp {
             return std::char_traits<char>::length(str);
         }
 
-        static int ascii_strncasecmp(const char *lhs, const char *rhs, size_t length) {
-            for (size_t index = 0; index < length; ++index) {
-                unsigned char lw = std::tolower(lhs[index]);
-                unsigned char rw = std::tolower(rhs[index]);
-                if (lw != rw) {
-                    return lw < rw ? -1 : 1;
+        size_t scan_first(const char_set &chars, size_t start_index, bool in_set) const {
+            if (start_index >= _length) {
+                return npos;
+            }
+            const char *p = mpp_impl::scan_first(_data + start_index, end(), chars.bytes(), in_set);
+            return p == nullptr ? npos : p - _data;
+        }
+
+        template <typename F>
+        size_t scan_if(const F &f, size_t start_index, bool expected, std::true_type) const {
+            if (start_index >= _length) {
+                return npos;
+            }
+            const char *p = mpp_impl::scan_first(_data + start_index, end(), f.bytes(), expected);
+            return p == nullptr ? npos : p - _data;
+        }
+
+        template <typename F>
+        size_t scan_if(const F &f, size_t start_index, bool expected, std::false_type) const {
+            for (const char *p = _data + std::min(start_index, _length), *e = end(); p != e; ++p) {
+                if (static_cast<bool>(f(*p)) == expected) {
+                    return p - _data;
                 }
             }
-            return 0;
+            return npos;
+        }
+
+        size_t scan_last(const char_set &chars, size_t start_index, bool in_set) const {
+            if (_length == 0) {
+                return npos;
+            }
+            const char *p = mpp_impl::scan_last(_data, _data + std::min(start_index, _length), chars.bytes(), in_set);
+            return p == nullptr ? npos : p - _data;
         }
 
     public:
@@ -220,6 +392,16 @@ namespace mpp {
                     safe_memcmp(_data, rhs._data, rhs._length) == 0);
         }
 
+        /**
+         * Hash the characters of the string, see mpp_impl::hash_bytes().
+         * Equal strings have equal hashes wherever the data resides.
+         *
+         * @return hash value
+         */
+        size_t hash() const {
+            return static_cast<size_t>(mpp_impl::hash_bytes(_data, _length));
+        }
+
         /**
          * Check for string equality, case insensitively.
          *
@@ -258,7 +440,7 @@ namespace mpp {
          * @return {@see string_ref::compare(string_ref)}
          */
         int compare_ignore_case(string_ref rhs) const {
-            int r = ascii_strncasecmp(_data, rhs._data, std::min(_length, rhs._length));
+            int r = mpp_impl::compare_ignore_case(_data, rhs._data, std::min(_length, rhs._length));
             if (r) {
                 return r;
             }
@@ -270,47 +452,109 @@ namespace mpp {
         }
 
         /**
-         * Compare two strings, treating sequences of digits as numbers.
+         * Compare two strings, treating sequences of digits as numbers,
+         * so "file9" < "file10". Leading zeros do not change the value of
+         * a number; among otherwise equal strings, the one whose first
+         * differing number has fewer leading zeros comes first ("a1" < "a01").
+         * Both strings are scanned once.
+         *
          * @param rhs
-         * @return
+         * @return {@see string_ref::compare(string_ref)}
          */
         int compare_numeric(string_ref rhs) const {
-            for (size_t i = 0, end = std::min(_length, rhs._length); i != end; ++i) {
-                // Check for sequences of digits.
-                if (std::isdigit(_data[i]) && std::isdigit(rhs._data[i])) {
-                    // The longer sequence of numbers is considered larger.
-                    // This doesn't really handle prefixed zeros well.
-                    size_t j = 0;
-                    for (j = i + 1; j != end + 1; ++j) {
-                        bool ld = j < _length && std::isdigit(_data[j]);
-                        bool rd = j < rhs._length && std::isdigit(rhs._data[j]);
-                        if (ld != rd) {
-                            return rd ? -1 : 1;
-                        }
-                        if (!rd) {
-                            break;
-                        }
-                    }
-
-                    // The two number sequences have the same length (j-i), just memcmp them.
-                    int r = safe_memcmp(_data + i, rhs._data + i, j - i);
-                    if (r) {
-                        return r < 0 ? -1 : 1;
+            const char *l = _data, *le = end(), *r = rhs._data, *re = rhs.end();
+            int tie = 0;
+            while (l != le && r != re) {
+                if (!is_digit(*l) || !is_digit(*r)) {
+                    if (*l != *r) {
+                        return (unsigned char) *l < (unsigned char) *r ? -1 : 1;
                     }
-                    // Identical number sequences, continue search after the numbers.
-                    i = j - 1;
+                    ++l;
+                    ++r;
                     continue;
                 }
 
-                if (_data[i] != rhs._data[i]) {
-                    return (unsigned char) _data[i] < (unsigned char) rhs._data[i] ? -1 : 1;
+                const char *lstart = l, *rstart = r;
+                while (l != le && *l == '0') { ++l; }
+                while (r != re && *r == '0') { ++r; }
+
+                // Walk the significant digits side by side: more digits is a
+                // larger number, otherwise the first differing digit decides.
+                int diff = 0;
+                for (;; ++l, ++r) {
+                    bool ld = l != le && is_digit(*l);
+                    bool rd = r != re && is_digit(*r);
+                    if (ld != rd) {
+                        return rd ? -1 : 1;
+                    }
+                    if (!ld) {
+                        break;
+                    }
+                    if (diff == 0 && *l != *r) {
+                        diff = *l < *r ? -1 : 1;
+                    }
+                }
+                if (diff) {
+                    return diff;
+                }
+                if (tie == 0 && l - lstart != r - rstart) {
+                    tie = l - lstart < r - rstart ? -1 : 1;
                 }
             }
 
-            if (_length == rhs._length) {
-                return 0;
+            if (l != le || r != re) {
+                return l == le ? -1 : 1;
             }
-            return _length < rhs._length ? -1 : 1;
+            return tie;
+        }
+
+        /**
+         * Build a key for this string such that comparing two keys as
+         * unsigned bytes (memcmp, or std::string's operator<) gives the
+         * same order as compare_numeric() on the original strings.
+         * Useful for sorting many strings: each one is parsed only once.
+         *
+         * @return the sort key
+         */
+        std::string numeric_key() const {
+            std::string key;
+            numeric_key(key);
+            return key;
+        }
+
+        /**
+         * Append the numeric sort key of this string to out.
+         * @see string_ref::numeric_key()
+         */
+        void numeric_key(std::string &out) const {
+            // Bytes other than digits are copied, with '\0' escaped as "\0\1".
+            // A number becomes '0', the count of significant digits and then
+            // the significant digits, so it orders against other bytes as a
+            // digit does. "\0\0" ends the string, followed by the count of
+            // leading zeros of each number to break ties.
+            std::string zeros;
+            out.reserve(out.size() + _length + 2);
+            for (const char *p = _data, *e = end(); p != e;) {
+                if (!is_digit(*p)) {
+                    out.push_back(*p);
+                    if (*p == '\0') {
+                        out.push_back('\1');
+                    }
+                    ++p;
+                    continue;
+                }
+                const char *start = p;
+                while (p != e && *p == '0') { ++p; }
+                const char *digits = p;
+                while (p != e && is_digit(*p)) { ++p; }
+                out.push_back('0');
+                append_ordered_size(out, p - digits);
+                out.append(digits, p);
+                append_ordered_size(zeros, digits - start);
+            }
+            out.push_back('\0');
+            out.push_back('\0');
+            out += zeros;
         }
 
         /**
@@ -339,7 +583,7 @@ namespace mpp {
          */
         bool startswith_ignore_case(string_ref prefix) const {
             return _length >= prefix._length &&
-                   ascii_strncasecmp(_data, prefix._data, prefix._length) == 0;
+                   mpp_impl::compare_ignore_case(_data, prefix._data, prefix._length) == 0;
         }
 
         /**
@@ -359,7 +603,7 @@ namespace mpp {
          */
         bool endswith_ignore_case(string_ref suffix) const {
             return _length >= suffix._length &&
-                   ascii_strncasecmp(end() - suffix._length, suffix._data, suffix._length) == 0;
+                   mpp_impl::compare_ignore_case(end() - suffix._length, suffix._data, suffix._length) == 0;
         }
 
         /**
@@ -387,28 +631,27 @@ namespace mpp {
          * @return index of the first c, or npos if not found
          */
         size_t find_ignore_case(char c, size_t start_index = 0) const {
-            int lc = std::tolower(c);
-            return find_if(
-                    [lc](char d) { return std::tolower(d) == lc; },
-                    start_index
-            );
+            auto lc = static_cast<char>(mpp_impl::ascii_fold(static_cast<unsigned char>(c)));
+            if (lc < 'a' || lc > 'z') {
+                return find(c, start_index);
+            }
+            char_set cases;
+            cases.add(lc).add(static_cast<char>(lc - 'a' + 'A'));
+            return find_first_of(cases, start_index);
         }
 
         /**
-         * Search for the first character satisfying the predicate f
-         * @param f
+         * Search for the first character satisfying the predicate f.
+         * The predicate is inlined, and char_set or the ascii_* classes
+         * are scanned 16 or 32 characters at a time.
+         *
+         * @param f callable with a char, returning bool
          * @param start_index
          * @return the position or npos
          */
-        size_t find_if(const mpp::function<bool(char)> &f, size_t start_index = 0) const {
-            string_ref s = drop_front(start_index);
-            while (!s.empty()) {
-                if (f(s.front())) {
-                    return size() - s.size();
-                }
-                s = s.drop_front();
-            }
-            return npos;
+        template <typename F>
+        size_t find_if(F &&f, size_t start_index = 0) const {
+            return scan_if(f, start_index, true, mpp_impl::has_byte_set<std::decay_t<F>>());
         }
 
         /**
@@ -417,11 +660,9 @@ namespace mpp {
          * @param start_index
          * @return
          */
-        size_t find_if_not(const mpp::function<bool(char)> &f, size_t start_index = 0) const {
-            return find_if(
-                    [&f](char c) { return !f(c); },
-                    start_index
-            );
+        template <typename F>
+        size_t find_if_not(F &&f, size_t start_index = 0) const {
+            return scan_if(f, start_index, false, mpp_impl::has_byte_set<std::decay_t<F>>());
         }
 
         size_t find(string_ref str, size_t start_index = 0) const {
@@ -445,50 +686,30 @@ namespace mpp {
                 return p == nullptr ? npos : p - _data;
             }
 
-            const char *end = start + (size - N + 1);
+            const char *p = mpp_impl::search_substring(start, start + size, needle, N);
+            return p == nullptr ? npos : p - _data;
+        }
 
-            // For short haystacks or unsupported needles fall back to the naive algorithm
-            if (size < 16 || N > 255) {
-                do {
-                    if (std::memcmp(start, needle, N) == 0)
-                        return start - _data;
-                    ++start;
-                } while (start < end);
+        size_t find_ignore_case(string_ref str, size_t start_index = 0) const {
+            if (start_index > _length) {
                 return npos;
             }
 
-            // Build the bad char heuristic table, with uint8_t to reduce cache thrashing.
-            uint8_t skipped[256];
-            // safe to convert from size_t to int
-            std::memset(skipped, static_cast<int>(N), 256);
-            for (unsigned i = 0; i != N - 1; ++i) {
-                // safe to convert from size_t to uint8_t
-                skipped[(uint8_t) str[i]] = static_cast<int>(N - 1 - i);
+            const char *start = _data + start_index;
+            size_t size = _length - start_index;
+            size_t N = str.size();
+            if (N == 0) {
+                return start_index;
             }
-
-            do {
-                uint8_t last = start[N - 1];
-                if (last == (uint8_t) needle[N - 1]
-                    && std::memcmp(start, needle, N - 1) == 0) {
-                    return start - _data;
-                }
-                // Otherwise skip the appropriate number of bytes.
-                start += skipped[last];
-            } while (start < end);
-
-            return npos;
-        }
-
-        size_t find_ignore_case(string_ref str, size_t start_index = 0) const {
-            string_ref _this = substr(start_index);
-            while (_this.size() >= str.size()) {
-                if (_this.startswith_ignore_case(str)) {
-                    return start_index;
-                }
-                _this = _this.drop_front();
-                ++start_index;
+            if (size < N) {
+                return npos;
             }
-            return npos;
+            if (N == 1) {
+                return find_ignore_case(str.front(), start_index);
+            }
+
+            const char *p = mpp_impl::search_substring_ignore_case(start, start + size, str.data(), N);
+            return p == nullptr ? npos : p - _data;
         }
 
         size_t rfind(char c, size_t start_index = npos) const {
@@ -506,9 +727,10 @@ namespace mpp {
         size_t rfind_ignore_case(char c, size_t start_index = npos) const {
             start_index = std::min(start_index, _length);
             size_t i = start_index;
+            auto lc = mpp_impl::ascii_fold(static_cast<unsigned char>(c));
             while (i != 0) {
                 --i;
-                if (std::tolower(_data[i]) == std::tolower(c)) {
+                if (mpp_impl::ascii_fold(static_cast<unsigned char>(_data[i])) == lc) {
                     return i;
                 }
             }
@@ -548,17 +770,11 @@ namespace mpp {
         }
 
         size_t find_first_of(string_ref chars, size_t start_index = 0) const {
-            std::bitset<1 << CHAR_BIT> char_bits;
-            for (size_type i = 0; i != chars.size(); ++i) {
-                char_bits.set((unsigned char) chars[i]);
-            }
+            return find_first_of(char_set(chars.data(), chars.size()), start_index);
+        }
 
-            for (size_type i = std::min(start_index, _length); i != _length; ++i) {
-                if (char_bits.test((unsigned char) _data[i])) {
-                    return i;
-                }
-            }
-            return npos;
+        size_t find_first_of(const char_set &chars, size_t start_index = 0) const {
+            return scan_first(chars, start_index, true);
         }
 
         size_t find_first_not_of(char c, size_t start_index = 0) const {
@@ -571,17 +787,11 @@ namespace mpp {
         }
 
         size_t find_first_not_of(string_ref chars, size_t start_index = 0) const {
-            std::bitset<1 << CHAR_BIT> char_bits;
-            for (size_type i = 0; i != chars.size(); ++i) {
-                char_bits.set((unsigned char) chars[i]);
-            }
+            return find_first_not_of(char_set(chars.data(), chars.size()), start_index);
+        }
 
-            for (size_type i = std::min(start_index, _length); i != _length; ++i) {
-                if (!char_bits.test((unsigned char) _data[i])) {
-                    return i;
-                }
-            }
-            return npos;
+        size_t find_first_not_of(const char_set &chars, size_t start_index = 0) const {
+            return scan_first(chars, start_index, false);
         }
 
         size_t find_last_of(char c, size_t start_index = npos) const {
@@ -589,17 +799,11 @@ namespace mpp {
         }
 
         size_t find_last_of(string_ref chars, size_t start_index = npos) const {
-            std::bitset<1 << CHAR_BIT> char_bits;
-            for (size_type i = 0; i != chars.size(); ++i) {
-                char_bits.set((unsigned char) chars[i]);
-            }
+            return find_last_of(char_set(chars.data(), chars.size()), start_index);
+        }
 
-            for (size_type i = std::min(start_index, _length) - 1; i != -1; --i) {
-                if (char_bits.test((unsigned char) _data[i])) {
-                    return i;
-                }
-            }
-            return npos;
+        size_t find_last_of(const char_set &chars, size_t start_index = npos) const {
+            return scan_last(chars, start_index, true);
         }
 
         size_t find_last_not_of(char c, size_t start_index = npos) const {
@@ -612,17 +816,11 @@ namespace mpp {
         }
 
         size_t find_last_not_of(string_ref chars, size_t start_index = npos) const {
-            std::bitset<1 << CHAR_BIT> char_bits;
-            for (size_type i = 0, e = chars.size(); i != e; ++i) {
-                char_bits.set((unsigned char) chars[i]);
-            }
+            return find_last_not_of(char_set(chars.data(), chars.size()), start_index);
+        }
 
-            for (size_type i = std::min(start_index, _length) - 1; i != -1; --i) {
-                if (!char_bits.test((unsigned char) _data[i])) {
-                    return i;
-                }
-            }
-            return npos;
+        size_t find_last_not_of(const char_set &chars, size_t start_index = npos) const {
+            return scan_last(chars, start_index, false);
         }
 
         bool contains(string_ref other) const { return find(other) != npos; }
@@ -636,47 +834,119 @@ namespace mpp {
         bool contains_ignore_case(char c) const { return find_ignore_case(c) != npos; }
 
         size_t count(char c) const {
-            size_t count = 0;
-            for (size_t i = 0; i != _length; ++i) {
-                if (_data[i] == c) {
-                    ++count;
-                }
-            }
-            return count;
+            return mpp_impl::count_byte(begin(), end(), c);
         }
 
-        size_t count(string_ref str) const {
-            size_t count = 0;
+        /**
+         * Count the occurrences of a string.
+         *
+         * @param str
+         * @param overlapping true to count "aa" in "aaa" twice, false once
+         * @return
+         */
+        size_t count(string_ref str, bool overlapping = true) const {
             size_t N = str.size();
             if (N > _length) {
                 return 0;
             }
-            for (size_t i = 0, end = _length - N + 1; i != end; ++i) {
-                if (substr(i, N).equals(str)) {
-                    ++count;
-                }
+            if (N == 0) {
+                // the empty string is everywhere
+                return _length + 1;
             }
-            return count;
+            if (N == 1) {
+                return count(str.front());
+            }
+            return mpp_impl::count_substring(begin(), end(), str.data(), N, overlapping);
         }
 
-        // Convert the given ASCII string to lowercase.
+        /**
+         * Convert the ASCII letters to lowercase, other bytes are kept.
+         * Unlike lower_locale(), this does not depend on the locale.
+         *
+         * @return the lowercase string
+         */
         std::string lower() const {
+            std::string result(size(), char());
+            lower_to(&result[0]);
+            return result;
+        }
+
+        /**
+         * Convert the ASCII letters to uppercase, other bytes are kept.
+         * Unlike upper_locale(), this does not depend on the locale.
+         *
+         * @return the uppercase string
+         */
+        std::string upper() const {
+            std::string result(size(), char());
+            upper_to(&result[0]);
+            return result;
+        }
+
+        /**
+         * Write the string with ASCII letters in lowercase into a buffer.
+         *
+         * @param buffer at least size() chars, may be data() itself
+         * @return the lowercase string in the buffer
+         */
+        string_ref lower_to(char *buffer) const {
+            mpp_impl::change_case(_data, buffer, _length, 'A');
+            return string_ref{buffer, _length};
+        }
+
+        /**
+         * Write the string with ASCII letters in uppercase into a buffer.
+         *
+         * @param buffer at least size() chars, may be data() itself
+         * @return the uppercase string in the buffer
+         */
+        string_ref upper_to(char *buffer) const {
+            mpp_impl::change_case(_data, buffer, _length, 'a');
+            return string_ref{buffer, _length};
+        }
+
+        /**
+         * Convert to lowercase with std::tolower in the current locale.
+         * @return
+         */
+        std::string lower_locale() const {
             std::string result(size(), char());
             for (size_type i = 0, e = size(); i != e; ++i) {
-                result[i] = std::tolower(_data[i]);
+                result[i] = static_cast<char>(std::tolower(static_cast<unsigned char>(_data[i])));
             }
             return result;
         }
 
-        /// Convert the given ASCII string to uppercase.
-        std::string upper() const {
+        /**
+         * Convert to uppercase with std::toupper in the current locale.
+         * @return
+         */
+        std::string upper_locale() const {
             std::string result(size(), char());
             for (size_type i = 0, e = size(); i != e; ++i) {
-                result[i] = std::toupper(_data[i]);
+                result[i] = static_cast<char>(std::toupper(static_cast<unsigned char>(_data[i])));
             }
             return result;
         }
 
+        /**
+         * Check if there is no uppercase ASCII letter, i.e. lower() would
+         * return the same string.
+         * @return
+         */
+        bool is_lower() const {
+            return find_if(ascii_upper()) == npos;
+        }
+
+        /**
+         * Check if there is no lowercase ASCII letter, i.e. upper() would
+         * return the same string.
+         * @return
+         */
+        bool is_upper() const {
+            return find_if(ascii_lower()) == npos;
+        }
+
         /**
          * Return a reference to the substring from [start_index, start_index + N).
          *
@@ -730,7 +1000,8 @@ namespace mpp {
          * @param f
          * @return
          */
-        string_ref take_while(const mpp::function<bool(char)> &f) const {
+        template <typename F>
+        string_ref take_while(F &&f) const {
             return substr(0, find_if_not(f));
         }
 
@@ -741,7 +1012,8 @@ namespace mpp {
          * @param f
          * @return
          */
-        string_ref take_until(const mpp::function<bool(char)> &f) const {
+        template <typename F>
+        string_ref take_until(F &&f) const {
             return substr(0, find_if(f));
         }
 
@@ -782,7 +1054,8 @@ namespace mpp {
          * @param f
          * @return
          */
-        string_ref drop_while(const mpp::function<bool(char)> &f) const {
+        template <typename F>
+        string_ref drop_while(F &&f) const {
             return substr(find_if_not(f));
         }
 
@@ -793,7 +1066,8 @@ namespace mpp {
          * @param f
          * @return
          */
-        string_ref drop_until(const mpp::function<bool(char)> &f) const {
+        template <typename F>
+        string_ref drop_until(F &&f) const {
             return substr(find_if(f));
         }
 
@@ -933,11 +1207,38 @@ namespace mpp {
             }
         }
 
+        /**
+         * Split into substrings around the occurrences of a separator lazily,
+         * with the same max_split and keep_empty rules as split(result, ...).
+         * The substrings are found one by one while iterating, so nothing is
+         * allocated and the iteration can stop early.
+         *
+         * A char_set separator splits at any of its characters, and it must
+         * outlive the returned range.
+         *
+         * @param separator The char, string or char_set to split on.
+         * @param max_split The maximum number of times the string is split.
+         * @param keep_empty True if empty substring should be yielded.
+         * @return the range of substrings
+         */
+        split_range<char> lazy_split(char separator, int max_split = -1,
+                                     bool keep_empty = true) const;
+
+        split_range<string_ref> lazy_split(string_ref separator, int max_split = -1,
+                                           bool keep_empty = true) const;
+
+        split_range<char_set> lazy_split(const char_set &separator, int max_split = -1,
+                                         bool keep_empty = true) const;
+
         string_ref ltrim(char chars) const {
             return drop_front(std::min(_length, find_first_not_of(chars)));
         }
 
-        string_ref ltrim(string_ref chars = " \t\n\v\f\r") const {
+        string_ref ltrim(string_ref chars) const {
+            return ltrim(char_set(chars.data(), chars.size()));
+        }
+
+        string_ref ltrim(const char_set &chars = char_set::whitespace()) const {
             return drop_front(std::min(_length, find_first_not_of(chars)));
         }
 
@@ -945,7 +1246,11 @@ namespace mpp {
             return drop_back(_length - std::min(_length, find_last_not_of(chars) + 1));
         }
 
-        string_ref rtrim(string_ref chars = " \t\n\v\f\r") const {
+        string_ref rtrim(string_ref chars) const {
+            return rtrim(char_set(chars.data(), chars.size()));
+        }
+
+        string_ref rtrim(const char_set &chars = char_set::whitespace()) const {
             return drop_back(_length - std::min(_length, find_last_not_of(chars) + 1));
         }
 
@@ -953,7 +1258,11 @@ namespace mpp {
             return ltrim(chars).rtrim(chars);
         }
 
-        string_ref trim(string_ref chars = " \t\n\v\f\r") const {
+        string_ref trim(string_ref chars) const {
+            return trim(char_set(chars.data(), chars.size()));
+        }
+
+        string_ref trim(const char_set &chars = char_set::whitespace()) const {
             return ltrim(chars).rtrim(chars);
         }
 
@@ -966,4 +1275,271 @@ namespace mpp {
 
     template <>
     struct is_iterable<mpp::string_ref> : public mpp::false_type {};
+
+    inline bool operator==(string_ref lhs, string_ref rhs) {
+        return lhs.equals(rhs);
+    }
+
+    inline bool operator!=(string_ref lhs, string_ref rhs) {
+        return !lhs.equals(rhs);
+    }
+
+    inline bool operator<(string_ref lhs, string_ref rhs) {
+        return lhs.compare(rhs) < 0;
+    }
+
+    /**
+     * Convert the ASCII letters to lowercase in place.
+     */
+    inline void lower_in_place(char *data, size_t length) {
+        mpp_impl::change_case(data, data, length, 'A');
+    }
+
+    inline void lower_in_place(std::string &str) {
+        lower_in_place(&str[0], str.size());
+    }
+
+    /**
+     * Convert the ASCII letters to uppercase in place.
+     */
+    inline void upper_in_place(char *data, size_t length) {
+        mpp_impl::change_case(data, data, length, 'a');
+    }
+
+    inline void upper_in_place(std::string &str) {
+        upper_in_place(&str[0], str.size());
+    }
+}
+
+namespace mpp_impl {
+    template <typename Separator>
+    struct split_separator;
+
+    template <>
+    struct split_separator<char> {
+        using stored_type = char;
+
+        static stored_type store(char separator) {
+            return separator;
+        }
+
+        static size_t find(mpp::string_ref str, char separator) {
+            return str.find(separator);
+        }
+
+        static size_t size(char) {
+            return 1;
+        }
+    };
+
+    template <>
+    struct split_separator<mpp::string_ref> {
+        using stored_type = mpp::string_ref;
+
+        static stored_type store(mpp::string_ref separator) {
+            return separator;
+        }
+
+        static size_t find(mpp::string_ref str, mpp::string_ref separator) {
+            return str.find(separator);
+        }
+
+        static size_t size(mpp::string_ref separator) {
+            return separator.size();
+        }
+    };
+
+    template <>
+    struct split_separator<mpp::char_set> {
+        using stored_type = const mpp::char_set *;
+
+        static stored_type store(const mpp::char_set &separator) {
+            return &separator;
+        }
+
+        static size_t find(mpp::string_ref str, const mpp::char_set *separator) {
+            return str.find_first_of(*separator);
+        }
+
+        static size_t size(const mpp::char_set *) {
+            return 1;
+        }
+    };
+}
+
+namespace mpp {
+    /**
+     * Forward iterator over the substrings of string_ref::lazy_split().
+     *
+     * @tparam Separator char, string_ref or char_set
+     */
+    template <typename Separator>
+    class split_iterator {
+    private:
+        using traits = mpp_impl::split_separator<Separator>;
+
+        enum class stage {
+            SPLITTING, TAIL, END,
+        };
+
+        string_ref _rest;
+        string_ref _piece;
+        typename traits::stored_type _separator{};
+        int _max_split = 0;
+        bool _keep_empty = true;
+        stage _stage = stage::END;
+
+        void advance() {
+            while (_stage == stage::SPLITTING) {
+                size_t index = _max_split-- != 0 ? traits::find(_rest, _separator) : string_ref::npos;
+                if (index == string_ref::npos) {
+                    _stage = stage::TAIL;
+                    // Yield the tail.
+                    if (_keep_empty || !_rest.empty()) {
+                        _piece = _rest;
+                        return;
+                    }
+                    break;
+                }
+
+                string_ref piece = _rest.slice(0, index);
+                // Jump forward.
+                _rest = _rest.slice(index + traits::size(_separator), string_ref::npos);
+                if (_keep_empty || index > 0) {
+                    _piece = piece;
+                    return;
+                }
+            }
+            _stage = stage::END;
+            _piece = string_ref();
+        }
+
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = string_ref;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const string_ref *;
+        using reference = const string_ref &;
+
+        /**
+         * The end iterator.
+         */
+        split_iterator() = default;
+
+        split_iterator(string_ref str, typename traits::stored_type separator,
+                       int max_split, bool keep_empty)
+                : _rest(str), _separator(separator), _max_split(max_split),
+                  _keep_empty(keep_empty), _stage(stage::SPLITTING) {
+            advance();
+        }
+
+        /**
+         * The part of the string after the current substring,
+         * not split yet.
+         */
+        string_ref rest() const {
+            return _stage == stage::SPLITTING ? _rest : string_ref();
+        }
+
+        reference operator*() const {
+            return _piece;
+        }
+
+        pointer operator->() const {
+            return &_piece;
+        }
+
+        split_iterator &operator++() {
+            advance();
+            return *this;
+        }
+
+        split_iterator operator++(int) {
+            split_iterator it = *this;
+            advance();
+            return it;
+        }
+
+        bool operator==(const split_iterator &other) const {
+            if (_stage != other._stage) {
+                return false;
+            }
+            return _stage == stage::END
+                   || (_piece.data() == other._piece.data() && _piece.size() == other._piece.size()
+                       && _rest.data() == other._rest.data());
+        }
+
+        bool operator!=(const split_iterator &other) const {
+            return !(*this == other);
+        }
+    };
+
+    /**
+     * The substrings of string_ref::lazy_split(), usable in range-for
+     * and anywhere an iterator_range is accepted.
+     *
+     * @tparam Separator char, string_ref or char_set
+     */
+    template <typename Separator>
+    class split_range : public iterator_range<split_iterator<Separator>> {
+    public:
+        using iterator = split_iterator<Separator>;
+
+        split_range(string_ref str, const Separator &separator, int max_split, bool keep_empty)
+                : iterator_range<iterator>(
+                iterator(str, mpp_impl::split_separator<Separator>::store(separator), max_split, keep_empty),
+                iterator()) {}
+
+        /**
+         * Collect the substrings, the same as string_ref::split(result, ...).
+         */
+        std::vector<string_ref> to_vector() const {
+            return std::vector<string_ref>(this->begin(), this->end());
+        }
+    };
+
+    inline split_range<char> string_ref::lazy_split(char separator, int max_split, bool keep_empty) const {
+        return split_range<char>(*this, separator, max_split, keep_empty);
+    }
+
+    inline split_range<string_ref> string_ref::lazy_split(string_ref separator, int max_split,
+                                                          bool keep_empty) const {
+        return split_range<string_ref>(*this, separator, max_split, keep_empty);
+    }
+
+    inline split_range<char_set> string_ref::lazy_split(const char_set &separator, int max_split,
+                                                        bool keep_empty) const {
+        return split_range<char_set>(*this, separator, max_split, keep_empty);
+    }
+
+    /**
+     * Write the string into the stream, respecting the width and fill
+     * settings of the stream, as operator<< of std::string does.
+     */
+    inline std::ostream &operator<<(std::ostream &out, string_ref str) {
+        size_t width = out.width() > 0 ? static_cast<size_t>(out.width()) : 0;
+        bool left = (out.flags() & std::ios::adjustfield) == std::ios::left;
+        if (width > str.size() && !left) {
+            for (size_t i = str.size(); i < width; ++i) {
+                out.put(out.fill());
+            }
+        }
+        out.write(str.data(), str.size());
+        if (width > str.size() && left) {
+            for (size_t i = str.size(); i < width; ++i) {
+                out.put(out.fill());
+            }
+        }
+        out.width(0);
+        return out;
+    }
+}
+
+namespace std {
+    template <>
+    struct hash<mpp::string_ref> {
+        size_t operator()(mpp::string_ref str) const noexcept {
+            return str.hash();
+        }
+    };
 }
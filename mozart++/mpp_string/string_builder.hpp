@@ -0,0 +1,296 @@
+/**
+ * Mozart++ Template Library: String/String Builder
+ * Licensed under Apache 2.0
+ * Copyright (C) 2020-2021 Chengdu Covariant Technologies Co., LTD.
+ * Website: https://covariant.cn/
+ * Github:  https://github.com/chengdu-zhirui/
+ */
+
+#pragma once
+
+#include "string.hpp"
+#include "format.hpp"
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace mpp {
+    /**
+     * Builds a long string out of many pieces without moving any of them
+     * once appended. The characters are copied into chunks which grow
+     * geometrically up to 1 MiB, and the result is kept as a list of
+     * segments: use segments() or fill_iovec() to write it out with
+     * writev(), or str() / copy_to() to get it in one piece with a
+     * single copy.
+     *
+     * It is also an output for mpp::format(out, fmt, args...) and
+     * format_to(builder, fmt, args...).
+     */
+    class string_builder {
+    private:
+        static constexpr size_t max_chunk_size = 1u << 20;
+
+        std::vector<std::unique_ptr<char[]>> _chunks;
+        std::vector<string_ref> _segments;
+        char *_cursor = nullptr;
+        char *_limit = nullptr;
+        size_t _size = 0;
+        size_t _first_chunk_size;
+        size_t _chunk_size;
+
+        /**
+         * Mark length chars written at _cursor, growing the last
+         * segment if it ends at the cursor.
+         */
+        void commit(size_t length) {
+            if (!_segments.empty() && _segments.back().end() == _cursor) {
+                string_ref &last = _segments.back();
+                last = string_ref(last.data(), last.size() + length);
+            } else {
+                _segments.emplace_back(_cursor, length);
+            }
+            _cursor += length;
+            _size += length;
+        }
+
+        /**
+         * Make room for at least length chars after the cursor.
+         */
+        void next_chunk(size_t length) {
+            size_t size = std::max(_chunk_size, length);
+            _chunks.emplace_back(new char[size]);
+            _cursor = _chunks.back().get();
+            _limit = _cursor + size;
+            if (_chunk_size < max_chunk_size) {
+                _chunk_size *= 2;
+            }
+        }
+
+    public:
+        /**
+         * @param chunk_size the size of the first chunk
+         */
+        explicit string_builder(size_t chunk_size = 1024)
+                : _first_chunk_size(chunk_size < 64 ? 64 : chunk_size), _chunk_size(_first_chunk_size) {}
+
+        string_builder(const string_builder &) = delete;
+
+        string_builder(string_builder &&other) noexcept
+                : _chunks(std::move(other._chunks)), _segments(std::move(other._segments)),
+                  _cursor(other._cursor), _limit(other._limit), _size(other._size),
+                  _first_chunk_size(other._first_chunk_size), _chunk_size(other._chunk_size) {
+            other._chunks.clear();
+            other._segments.clear();
+            other._cursor = other._limit = nullptr;
+            other._size = 0;
+        }
+
+        string_builder &operator=(const string_builder &) = delete;
+
+        string_builder &operator=(string_builder &&other) noexcept {
+            if (this != &other) {
+                _chunks = std::move(other._chunks);
+                _segments = std::move(other._segments);
+                _cursor = other._cursor;
+                _limit = other._limit;
+                _size = other._size;
+                _first_chunk_size = other._first_chunk_size;
+                _chunk_size = other._chunk_size;
+                other._chunks.clear();
+                other._segments.clear();
+                other._cursor = other._limit = nullptr;
+                other._size = 0;
+            }
+            return *this;
+        }
+
+        /**
+         * Copy the chars into the builder.
+         */
+        string_builder &append(string_ref str) {
+            const char *data = str.data();
+            size_t length = str.size();
+            size_t room = _limit - _cursor;
+            if (length > room) {
+                // fill the current chunk up, the rest goes to a new one
+                if (room != 0) {
+                    std::memcpy(_cursor, data, room);
+                    commit(room);
+                    data += room;
+                    length -= room;
+                }
+                next_chunk(length);
+            }
+            if (length != 0) {
+                std::memcpy(_cursor, data, length);
+                commit(length);
+            }
+            return *this;
+        }
+
+        string_builder &append(size_t count, char c) {
+            while (count != 0) {
+                if (_cursor == _limit) {
+                    next_chunk(count);
+                }
+                size_t n = std::min(count, static_cast<size_t>(_limit - _cursor));
+                std::memset(_cursor, c, n);
+                commit(n);
+                count -= n;
+            }
+            return *this;
+        }
+
+        string_builder &push_back(char c) {
+            if (_cursor == _limit) {
+                next_chunk(1);
+            }
+            *_cursor = c;
+            commit(1);
+            return *this;
+        }
+
+        /**
+         * Add the chars as a segment of their own, without copying them.
+         * They must stay valid as long as the builder is used.
+         */
+        string_builder &append_ref(string_ref str) {
+            if (!str.empty()) {
+                _segments.push_back(str);
+                _size += str.size();
+            }
+            return *this;
+        }
+
+        string_builder &operator<<(string_ref str) {
+            return append(str);
+        }
+
+        string_builder &operator<<(const char *str) {
+            return append(string_ref(str));
+        }
+
+        string_builder &operator<<(const std::string &str) {
+            return append(string_ref(str));
+        }
+
+        string_builder &operator<<(char c) {
+            return push_back(c);
+        }
+
+        /**
+         * Other values are written as char_buffer writes them,
+         * i.e. as a default std::ostream would.
+         */
+        template <typename T>
+        auto operator<<(const T &value)
+        -> std::enable_if_t<!std::is_convertible<const T &, string_ref>::value,
+            decltype(std::declval<char_buffer &>() << value, std::declval<string_builder &>())> {
+            char_buffer buffer;
+            buffer << value;
+            return append(buffer.ref());
+        }
+
+        /**
+         * @return total number of chars
+         */
+        size_t size() const {
+            return _size;
+        }
+
+        bool empty() const {
+            return _size == 0;
+        }
+
+        /**
+         * The contents, in order, as pieces of memory
+         * that stay valid until the builder is cleared.
+         */
+        const std::vector<string_ref> &segments() const {
+            return _segments;
+        }
+
+        /**
+         * Describe the segments from first on in an array of iovec-like
+         * structs, i.e. any type with iov_base and iov_len members.
+         *
+         * @param iov the array
+         * @param count size of the array
+         * @param first index of the first segment to describe
+         * @return number of entries filled
+         */
+        template <typename IoVec>
+        size_t fill_iovec(IoVec *iov, size_t count, size_t first = 0) const {
+            size_t n = 0;
+            for (size_t i = first; i < _segments.size() && n != count; ++i, ++n) {
+                iov[n].iov_base = const_cast<char *>(_segments[i].data());
+                iov[n].iov_len = _segments[i].size();
+            }
+            return n;
+        }
+
+        /**
+         * Copy the contents to out, which must have room for size() chars.
+         *
+         * @return past the last char written
+         */
+        char *copy_to(char *out) const {
+            for (string_ref segment : _segments) {
+                std::memcpy(out, segment.data(), segment.size());
+                out += segment.size();
+            }
+            return out;
+        }
+
+        /**
+         * The contents in one piece.
+         */
+        std::string str() const {
+            std::string result(_size, '\0');
+            copy_to(&result[0]);
+            return result;
+        }
+
+        /**
+         * Drop the contents and release the chunks. The next chunk
+         * is as small as the first one again.
+         */
+        void clear() {
+            _chunks.clear();
+            _segments.clear();
+            _cursor = _limit = nullptr;
+            _size = 0;
+            _chunk_size = _first_chunk_size;
+        }
+    };
+
+    /**
+     * Append the formatted text to the builder.
+     *
+     * @param builder the builder
+     * @param fmt format string, or a compiled_format
+     */
+    template <typename Fmt, typename ...Args>
+    void format_to(string_builder &builder, Fmt &&fmt, Args &&... args) {
+        char_buffer buffer;
+        format_to(buffer, std::forward<Fmt>(fmt), std::forward<Args>(args)...);
+        builder.append(buffer.ref());
+    }
+}
+
+namespace mpp_impl {
+    /**
+     * Formats for string_builder are done in a char_buffer with default
+     * formatting state, and then appended at once.
+     */
+    template <>
+    struct output_adaptor<mpp::string_builder> {
+        template <typename F>
+        static void doit(mpp::string_builder &out, F &&f) {
+            mpp::char_buffer buffer;
+            f(buffer);
+            out.append(buffer.ref());
+        }
+    };
+}
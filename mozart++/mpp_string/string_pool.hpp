@@ -0,0 +1,194 @@
+/**
+ * Mozart++ Template Library: String/String Pool
+ * Licensed under Apache 2.0
+ * Copyright (C) 2020-2021 Chengdu Covariant Technologies Co., LTD.
+ * Website: https://covariant.cn/
+ * Github:  https://github.com/chengdu-zhirui/
+ */
+
+#pragma once
+
+#include <mozart++/memory>
+#include "string.hpp"
+#include <vector>
+
+namespace mpp {
+    /**
+     * An interner: keeps one copy of every distinct string given to it,
+     * in an arena owned by the pool, and hands out string_refs to it.
+     *
+     * The strings stay where they are until the pool is cleared or
+     * destroyed, so the returned string_refs may be stored. Two strings
+     * interned in the same pool are equal if and only if their data()
+     * pointers are equal, which makes comparing them O(1).
+     * The empty string is always interned as string_ref{}.
+     */
+    class string_pool {
+    private:
+        struct slot {
+            // nullptr for an unused slot
+            const char *data;
+            size_t length;
+            size_t hash;
+        };
+
+        mpp::arena_allocator _arena;
+
+        // open addressing with linear probing, the size is a power of two
+        std::vector<slot> _slots;
+        size_t _size = 0;
+
+        size_t probe(string_ref str, size_t hash) const {
+            size_t mask = _slots.size() - 1;
+            for (size_t i = hash & mask;; i = (i + 1) & mask) {
+                const slot &s = _slots[i];
+                if (s.data == nullptr ||
+                    (s.hash == hash && string_ref(s.data, s.length).equals(str))) {
+                    return i;
+                }
+            }
+        }
+
+        void grow() {
+            std::vector<slot> slots(_slots.empty() ? 64 : _slots.size() * 2, slot{nullptr, 0, 0});
+            size_t mask = slots.size() - 1;
+            for (const slot &s : _slots) {
+                if (s.data == nullptr) {
+                    continue;
+                }
+                size_t i = s.hash & mask;
+                while (slots[i].data != nullptr) {
+                    i = (i + 1) & mask;
+                }
+                slots[i] = s;
+            }
+            _slots.swap(slots);
+        }
+
+    public:
+        /**
+         * @param chunk_size the size of the first arena chunk
+         */
+        explicit string_pool(size_t chunk_size = 4096)
+                : _arena(chunk_size) {}
+
+        string_pool(const string_pool &) = delete;
+
+        string_pool(string_pool &&other) noexcept
+                : _arena(std::move(other._arena)), _slots(std::move(other._slots)), _size(other._size) {
+            other._slots.clear();
+            other._size = 0;
+        }
+
+        string_pool &operator=(const string_pool &) = delete;
+
+        string_pool &operator=(string_pool &&other) noexcept {
+            if (this != &other) {
+                _arena = std::move(other._arena);
+                _slots = std::move(other._slots);
+                _size = other._size;
+                other._slots.clear();
+                other._size = 0;
+            }
+            return *this;
+        }
+
+        /**
+         * Get the pooled copy of a string, copying it into the pool
+         * the first time it is seen.
+         *
+         * @param str the string
+         * @return the pooled string
+         */
+        string_ref intern(string_ref str) {
+            return intern(str, str.hash());
+        }
+
+        /**
+         * Same as intern(str), with the hash of str already known.
+         *
+         * @param str the string
+         * @param hash str.hash()
+         * @return the pooled string
+         */
+        string_ref intern(string_ref str, size_t hash) {
+            if (str.empty()) {
+                return string_ref{};
+            }
+            if ((_size + 1) * 4 > _slots.size() * 3) {
+                grow();
+            }
+            slot &s = _slots[probe(str, hash)];
+            if (s.data == nullptr) {
+                string_ref copied = str.copy(_arena);
+                s = slot{copied.data(), copied.size(), hash};
+                ++_size;
+            }
+            return string_ref(s.data, s.length);
+        }
+
+        /**
+         * Look up a string without interning it.
+         *
+         * @param str the string
+         * @param pooled set to the pooled string if found
+         * @return whether str is in the pool
+         */
+        bool lookup(string_ref str, string_ref &pooled) const {
+            if (str.empty()) {
+                pooled = string_ref{};
+                return true;
+            }
+            if (_slots.empty()) {
+                return false;
+            }
+            const slot &s = _slots[probe(str, str.hash())];
+            if (s.data == nullptr) {
+                return false;
+            }
+            pooled = string_ref(s.data, s.length);
+            return true;
+        }
+
+        bool contains(string_ref str) const {
+            string_ref pooled;
+            return lookup(str, pooled);
+        }
+
+        /**
+         * Check whether a string_ref points into this pool's copy of its
+         * contents, i.e. whether it was returned by intern().
+         */
+        bool owns(string_ref str) const {
+            string_ref pooled;
+            return lookup(str, pooled) && pooled.data() == str.data();
+        }
+
+        /**
+         * The number of distinct non-empty strings in the pool.
+         */
+        size_t size() const {
+            return _size;
+        }
+
+        bool empty() const {
+            return _size == 0;
+        }
+
+        /**
+         * Bytes held by the pool: the arena and the hash table.
+         */
+        size_t memory_usage() const {
+            return _arena.allocated_bytes() + _slots.capacity() * sizeof(slot);
+        }
+
+        /**
+         * Drop every string. All string_refs returned so far become invalid.
+         */
+        void clear() {
+            _arena.release();
+            std::vector<slot>().swap(_slots);
+            _size = 0;
+        }
+    };
+}
@@ -40,6 +40,16 @@ void split_path_mpp(const char *path) {
     mpp::string_ref(path).split(s, ':');
 }
 
+void split_path_lazy(const char *path) {
+    size_t length = 0;
+    for (mpp::string_ref s : mpp::string_ref(path).lazy_split(':')) {
+        length += s.size();
+    }
+    // keep the loop from being optimized out
+    volatile size_t sink = length;
+    (void) sink;
+}
+
 void split_path_std(const char *path) {
     size_t start = 0;
     size_t end;
@@ -69,6 +79,7 @@ int main() {
     const char *path = getenv("PATH");
     benchmark("c   ", path, split_path_c);
     benchmark("mpp ", path, split_path_mpp);
+    benchmark("lazy", path, split_path_lazy);
     benchmark("std ", path, split_path_std);
 }
 
@@ -0,0 +1,129 @@
+/**
+ * Mozart++ Template Library
+ * Licensed under Apache 2.0
+ * Copyright (C) 2020-2021 Chengdu Covariant Technologies Co., LTD.
+ * Website: https://covariant.cn/
+ * Github:  https://github.com/chengdu-zhirui/
+ */
+
+#include <mozart++/timer>
+#include <mozart++/any>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <typeinfo>
+#include <vector>
+
+struct point {
+    int x, y;
+};
+
+enum class color {
+    red, green, blue
+};
+
+/**
+ * The previous mpp::hash: std::hash plus the typeid hash for enums,
+ * std::hash alone for other types, 0 without std::hash.
+ */
+std::size_t legacy_hash(int v) {
+    return std::hash<int>()(v);
+}
+
+std::size_t legacy_hash(double v) {
+    return std::hash<double>()(v);
+}
+
+std::size_t legacy_hash(color v) {
+    return std::hash<std::size_t>()(static_cast<std::size_t>(v)) + typeid(color).hash_code();
+}
+
+std::size_t legacy_hash(const point &) {
+    return 0;
+}
+
+/**
+ * Keys landing in an occupied bucket of a power-of-two table of as many
+ * buckets as keys, indexed by the low bits as open addressing tables do.
+ * Uniform hashes give about 37% of the keys.
+ */
+template <typename T, typename Hash>
+std::size_t collisions(const std::vector<T> &keys, Hash hash) {
+    std::size_t buckets = 1;
+    while (buckets < keys.size())
+        buckets <<= 1;
+    std::vector<bool> used(buckets);
+    std::size_t count = 0;
+    for (const T &key : keys) {
+        std::size_t index = hash(key) & (buckets - 1);
+        if (used[index])
+            ++count;
+        used[index] = true;
+    }
+    return count;
+}
+
+template <typename T>
+void report(const char *name, const std::vector<T> &keys) {
+    std::cout << "[Collisions] " << name << " of " << keys.size() << ": legacy "
+              << collisions(keys, [](const T &v) { return legacy_hash(v); }) << ", mpp::hash "
+              << collisions(keys, [](const T &v) { return mpp::hash(v); }) << ", mpp::any::hash "
+              << collisions(keys, [](const T &v) { return mpp::any(v).hash(); }) << std::endl;
+}
+
+/**
+ * Usage: benchmark-any-hash [count], 1000000 by default.
+ */
+int main(int argc, const char **argv) {
+    std::size_t count = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1000000;
+
+    std::vector<int> sequential, strided;
+    std::vector<double> halves;
+    std::vector<point> points;
+    for (std::size_t i = 0; i < count; ++i) {
+        sequential.push_back(static_cast<int>(i));
+        strided.push_back(static_cast<int>(i * 1024));
+        halves.push_back(static_cast<double>(i) / 2);
+        points.push_back(point{static_cast<int>(i % 1000), static_cast<int>(i / 1000)});
+    }
+    report("sequential ints", sequential);
+    report("ints strided by 1024", strided);
+    report("doubles", halves);
+    report("points", points);
+
+    std::cout << std::endl;
+
+    std::vector<mpp::any> values;
+    std::vector<color> colors;
+    for (std::size_t i = 0; i < count; ++i) {
+        if (i % 2 == 0)
+            values.emplace_back(static_cast<int>(i));
+        else
+            values.emplace_back(static_cast<double>(i));
+        colors.push_back(static_cast<color>(i % 3));
+    }
+
+    std::size_t sum = 0;
+    std::cout << "[Throughput] legacy enum hash: " << mpp::timer::measure([&]() {
+        for (color c : colors)
+            sum += legacy_hash(c);
+    }) << std::endl;
+    std::cout << "[Throughput] mpp::hash enum: " << mpp::timer::measure([&]() {
+        for (color c : colors)
+            sum += mpp::hash(c);
+    }) << std::endl;
+    std::cout << "[Throughput] mpp::any::hash: " << mpp::timer::measure([&]() {
+        for (const mpp::any &v : values)
+            sum += v.hash();
+    }) << std::endl;
+    std::cout << "[Throughput] mpp::any::hash with typeid, as before: " << mpp::timer::measure([&]() {
+        for (const mpp::any &v : values) {
+            if (const int *i = v.try_get<int>())
+                sum += legacy_hash(*i) + v.data_type().hash_code();
+            else
+                sum += legacy_hash(v.get_unsafe<double>()) + v.data_type().hash_code();
+        }
+    }) << std::endl;
+
+    return sum == 0 ? 1 : 0;
+}
@@ -1,7 +1,9 @@
 #include <mozart++/timer>
 #include <mozart++/any>
+#include <mozart++/string>
 #include <iostream>
 #include <string>
+#include <vector>
 #include <any>
 
 int test_epoch = 10000000;
@@ -13,6 +15,20 @@ struct test_large_data {
     test_large_data(const char *s) : str(s) {}
 };
 
+struct size_visitor {
+    long operator()(int x) const {
+        return x;
+    }
+
+    long operator()(double x) const {
+        return static_cast<long>(x);
+    }
+
+    long operator()(const std::string &x) const {
+        return static_cast<long>(x.size());
+    }
+};
+
 int main() {
     std::cout << "Size of std::any        : " << sizeof(std::any) << std::endl;
     std::cout << "Size of mpp::any        : " << sizeof(mpp::any) << std::endl;
@@ -30,6 +46,17 @@ int main() {
             mpp::any b(a);
     }) << std::endl;
 
+    std::cout << "[Small Data] std::any copying string_ref: " << mpp::timer::measure([]() {
+        std::any a(mpp::string_ref("Hello"));
+        for (int i = 0; i < test_epoch; ++i)
+            std::any b(a);
+    }) << std::endl;
+    std::cout << "[Small Data] mpp::any copying string_ref: " << mpp::timer::measure([]() {
+        mpp::any a(mpp::string_ref("Hello"));
+        for (int i = 0; i < test_epoch; ++i)
+            mpp::any b(a);
+    }) << std::endl;
+
     std::cout << std::endl;
 
     std::cout << "[Small Data] std::any instancing: " << mpp::timer::measure([]() {
@@ -77,5 +104,112 @@ int main() {
         }
     }) << std::endl;
 
-    return 0;
+    std::cout << std::endl;
+
+    // a burst of frees, then as many allocations
+    std::cout << "[Large Data] std::any burst reuse: " << mpp::timer::measure([]() {
+        std::vector<std::any> values;
+        for (int round = 0; round < 2; ++round) {
+            for (int i = 0; i < test_epoch / 25; ++i)
+                values.emplace_back(std::string(40, 'a'));
+            values.clear();
+        }
+    }) << std::endl;
+    std::cout << "[Large Data] mpp::any burst reuse: " << mpp::timer::measure([]() {
+        std::vector<mpp::any> values;
+        for (int round = 0; round < 2; ++round) {
+            for (int i = 0; i < test_epoch / 25; ++i)
+                values.emplace_back(std::string(40, 'a'));
+            values.clear();
+        }
+    }) << std::endl;
+
+    std::cout << std::endl;
+
+    long sum = 0;
+    std::vector<std::any> std_values;
+    std::vector<mpp::any> mpp_values;
+    for (int i = 0; i < 1000; ++i) {
+        if (i % 3 == 0) {
+            std_values.emplace_back(i);
+            mpp_values.emplace_back(i);
+        } else if (i % 3 == 1) {
+            std_values.emplace_back(double(i));
+            mpp_values.emplace_back(double(i));
+        } else {
+            std_values.emplace_back(std::string("x"));
+            mpp_values.emplace_back(std::string("x"));
+        }
+    }
+    std::cout << "[Mixed Data] std::any dispatch by type(): " << mpp::timer::measure([&]() {
+        for (int i = 0; i < test_epoch / 1000; ++i) {
+            for (const std::any &v : std_values) {
+                if (v.type() == typeid(int))
+                    sum += std::any_cast<int>(v);
+                else if (v.type() == typeid(double))
+                    sum += static_cast<long>(std::any_cast<double>(v));
+                else
+                    sum += static_cast<long>(std::any_cast<const std::string &>(v).size());
+            }
+        }
+    }) << std::endl;
+    std::cout << "[Mixed Data] mpp::any dispatch by tag(): " << mpp::timer::measure([&]() {
+        for (int i = 0; i < test_epoch / 1000; ++i) {
+            for (const mpp::any &v : mpp_values) {
+                if (v.tag() == mpp::any::tag_of<int>())
+                    sum += v.get_unsafe<int>();
+                else if (v.tag() == mpp::any::tag_of<double>())
+                    sum += static_cast<long>(v.get_unsafe<double>());
+                else
+                    sum += static_cast<long>(v.get_unsafe<std::string>().size());
+            }
+        }
+    }) << std::endl;
+    std::cout << "[Mixed Data] mpp::visit: " << mpp::timer::measure([&]() {
+        using types = mpp::typelist::list<int, double, std::string>;
+        for (int i = 0; i < test_epoch / 1000; ++i) {
+            for (const mpp::any &v : mpp_values) {
+                sum += mpp::visit<types>(v, size_visitor());
+            }
+        }
+    }) << std::endl;
+
+    std::cout << std::endl;
+
+    // rows of 4 ints and a double
+    mpp::any_vector rows;
+    std::vector<mpp::any> row_anys;
+    for (int i = 0; i < 100000; ++i) {
+        for (int j = 0; j < 4; ++j) {
+            rows.push_back(i + j);
+            row_anys.emplace_back(i + j);
+        }
+        rows.push_back(i * 0.5);
+        row_anys.emplace_back(i * 0.5);
+    }
+    std::vector<std::size_t> hashes(rows.size());
+    std::cout << "[Records] std::vector<mpp::any> hashing: " << mpp::timer::measure([&]() {
+        for (int i = 0; i < test_epoch / 1000000; ++i) {
+            for (size_t k = 0; k < row_anys.size(); ++k)
+                hashes[k] = row_anys[k].hash();
+        }
+    }) << std::endl;
+    std::cout << "[Records] mpp::any_vector hash_all: " << mpp::timer::measure([&]() {
+        for (int i = 0; i < test_epoch / 1000000; ++i)
+            rows.hash_all(hashes.data());
+    }) << std::endl;
+    std::cout << "[Records] std::vector<mpp::any> summing ints: " << mpp::timer::measure([&]() {
+        for (int i = 0; i < test_epoch / 1000000; ++i) {
+            for (const mpp::any &v : row_anys) {
+                if (const int *p = v.try_get<int>())
+                    sum += *p;
+            }
+        }
+    }) << std::endl;
+    std::cout << "[Records] mpp::any_vector for_each<int>: " << mpp::timer::measure([&]() {
+        for (int i = 0; i < test_epoch / 1000000; ++i)
+            rows.for_each<int>([&](size_t, int v) { sum += v; });
+    }) << std::endl;
+
+    return sum == 0;
 }
@@ -0,0 +1,69 @@
+/**
+ * Mozart++ Template Library
+ * Licensed under Apache 2.0
+ * Copyright (C) 2020-2021 Chengdu Covariant Technologies Co., LTD.
+ * Website: https://covariant.cn/
+ * Github:  https://github.com/chengdu-zhirui/
+ */
+
+#include <mozart++/timer>
+#include <mozart++/format>
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+
+int test_epoch = 100000;
+
+#define METRIC_FORMAT "{} count={} sum={.3} mean={e} bytes={x:12|0} mode={o}\n"
+
+void stream_metric(std::ostream &out, int i) {
+    auto flags = out.flags();
+    out << "requests" << " count=" << i
+        << " sum=" << std::fixed << std::setprecision(3) << i * 1.25
+        << " mean=";
+    out.flags(flags);
+    out << std::scientific << i / 7.0;
+    out.flags(flags);
+    out << " bytes=" << std::hex << std::showbase << std::setw(12) << std::setfill('0') << i * 4096;
+    out.flags(flags);
+    out << " mode=" << std::oct << std::showbase << 0644;
+    out.flags(flags);
+    out << std::setprecision(6) << std::setfill(' ') << '\n';
+}
+
+int main() {
+    std::ostringstream expected;
+    stream_metric(expected, 42);
+    std::string actual = mpp::format(METRIC_FORMAT, "requests", 42, 42 * 1.25, 42 / 7.0, 42 * 4096, 0644);
+    if (expected.str() != actual) {
+        std::cout << "Outputs mismatch:\n" << expected.str() << actual;
+        return 1;
+    }
+
+    std::cout << "[Numbers] std::ostream: " << mpp::timer::measure([]() {
+        std::ostringstream out;
+        for (int i = 0; i < test_epoch; ++i)
+            stream_metric(out, i);
+    }) << std::endl;
+    std::cout << "[Numbers] mpp::format(std::ostream): " << mpp::timer::measure([]() {
+        std::ostringstream out;
+        for (int i = 0; i < test_epoch; ++i)
+            mpp::format(out, mpp_format_string(METRIC_FORMAT), "requests", i, i * 1.25, i / 7.0, i * 4096, 0644);
+    }) << std::endl;
+    std::cout << "[Numbers] mpp::format_to: " << mpp::timer::measure([]() {
+        mpp::char_buffer buffer;
+        for (int i = 0; i < test_epoch; ++i)
+            mpp::format_to(buffer, mpp_format_string(METRIC_FORMAT), "requests", i, i * 1.25, i / 7.0, i * 4096, 0644);
+    }) << std::endl;
+    std::cout << "[Numbers] snprintf: " << mpp::timer::measure([]() {
+        std::string out;
+        char buf[256];
+        for (int i = 0; i < test_epoch; ++i) {
+            int n = std::snprintf(buf, sizeof(buf), "%s count=%d sum=%.3f mean=%.3e bytes=%#12x mode=%#o\n",
+                                  "requests", i, i * 1.25, i / 7.0, i * 4096, 0644);
+            out.append(buf, n);
+        }
+    }) << std::endl;
+
+    return 0;
+}
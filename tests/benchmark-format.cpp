@@ -0,0 +1,92 @@
+/**
+ * Mozart++ Template Library
+ * Licensed under Apache 2.0
+ * Copyright (C) 2020-2021 Chengdu Covariant Technologies Co., LTD.
+ * Website: https://covariant.cn/
+ * Github:  https://github.com/chengdu-zhirui/
+ */
+
+#include <mozart++/timer>
+#include <mozart++/format>
+#include <iostream>
+#include <regex>
+#include <sstream>
+
+int test_epoch = 100000;
+
+/**
+ * The previous regex-based formatter, kept here as the baseline.
+ */
+template <typename T>
+bool regex_format_one(std::ostream &out, mpp::string_ref &fmt, T &&t) {
+    std::regex r(R"(\{(\.[0-9]+)?([xdoe])?(\:\-?[0-9]+(\|.)?)?\})");
+    std::regex_iterator<const char *> re_begin(fmt.begin(), fmt.end(), r), re_end;
+    if (re_begin == re_end) {
+        return false;
+    }
+    mpp_impl::placeholder_spec spec;
+    mpp_impl::parse_placeholder(fmt.data() + re_begin->position(0), fmt.end(), spec);
+    out << fmt.slice(0, re_begin->position(0)).str();
+    mpp_impl::write_value_and_control(out, std::forward<T>(t), spec);
+    fmt = fmt.substr(re_begin->position(0) + re_begin->length(0));
+    return true;
+}
+
+void regex_format_impl(std::ostream &, mpp::string_ref &) {
+}
+
+template <typename T, typename ...Args>
+void regex_format_impl(std::ostream &out, mpp::string_ref &fmt, T &&head, Args &&... args) {
+    if (regex_format_one(out, fmt, std::forward<T>(head))) {
+        regex_format_impl(out, fmt, std::forward<Args>(args)...);
+    }
+}
+
+template <typename ...Args>
+std::string regex_format(const std::string &fmt, Args &&... args) {
+    std::stringstream out;
+    mpp::string_ref fmt_ref{fmt};
+    regex_format_impl(out, fmt_ref, std::forward<Args>(args)...);
+    out << fmt_ref.str();
+    return out.str();
+}
+
+#define LOG_FORMAT "[{}] request {} from {} took {.3}ms, status {x:-6|.}\n"
+
+int main() {
+    std::string fmt = LOG_FORMAT;
+
+    std::string a = regex_format(fmt, "INFO", 42, "127.0.0.1", 3.14159, 200);
+    std::string b = mpp::format(fmt, "INFO", 42, "127.0.0.1", 3.14159, 200);
+    std::string c = mpp::format(mpp_cached_format(LOG_FORMAT), "INFO", 42, "127.0.0.1", 3.14159, 200);
+    if (a != b || a != c) {
+        std::cout << "Outputs mismatch:\n" << a << b << c;
+        return 1;
+    }
+
+    std::cout << "[Format] regex: " << mpp::timer::measure([&fmt]() {
+        for (int i = 0; i < test_epoch; ++i)
+            regex_format(fmt, "INFO", i, "127.0.0.1", 3.14159, 200);
+    }) << std::endl;
+    std::cout << "[Format] mpp::format: " << mpp::timer::measure([&fmt]() {
+        for (int i = 0; i < test_epoch; ++i)
+            mpp::format(fmt, "INFO", i, "127.0.0.1", 3.14159, 200);
+    }) << std::endl;
+    std::cout << "[Format] mpp::compiled_format: " << mpp::timer::measure([&fmt]() {
+        for (int i = 0; i < test_epoch; ++i)
+            mpp::format(mpp_cached_format(LOG_FORMAT), "INFO", i, "127.0.0.1", 3.14159, 200);
+    }) << std::endl;
+    std::cout << "[Format] mpp_format_string: " << mpp::timer::measure([]() {
+        for (int i = 0; i < test_epoch; ++i)
+            mpp::format(mpp_format_string(LOG_FORMAT), "INFO", i, "127.0.0.1", 3.14159, 200);
+    }) << std::endl;
+    std::cout << "[Format] mpp::format_to: " << mpp::timer::measure([]() {
+        mpp::char_buffer buffer;
+        for (int i = 0; i < test_epoch; ++i) {
+            buffer.clear();
+            mpp::format_to(buffer, mpp_cached_format(LOG_FORMAT), "INFO", i, "127.0.0.1", 3.14159, 200);
+        }
+    }) << std::endl;
+
+    return 0;
+}
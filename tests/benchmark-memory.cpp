@@ -0,0 +1,187 @@
+/**
+ * Mozart++ Template Library
+ * Licensed under Apache 2.0
+ * Copyright (C) 2020-2021 Chengdu Covariant Technologies Co., LTD.
+ * Website: https://covariant.cn/
+ * Github:  https://github.com/chengdu-zhirui/
+ */
+
+#include <mozart++/timer>
+#include <mozart++/memory>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <thread>
+#include <vector>
+
+struct object {
+    long data[4];
+
+    explicit object(long v) : data{v, v, v, v} {}
+};
+
+std::vector<std::size_t> make_slots(std::size_t count, std::size_t live) {
+    std::mt19937 rng(1);
+    std::vector<std::size_t> slots(count);
+    for (std::size_t &slot : slots)
+        slot = rng() % live;
+    return slots;
+}
+
+/**
+ * Keep live objects and replace a random one at a time:
+ * one free and one allocation per step.
+ */
+template <template <typename> class Alloc>
+long churn(const std::vector<std::size_t> &slots, std::size_t live) {
+    Alloc<object> alloc;
+    std::vector<object *> objects(live);
+    for (std::size_t i = 0; i < live; ++i)
+        objects[i] = ::new(alloc.allocate(1)) object(long(i));
+    long sum = 0;
+    for (std::size_t i = 0; i < slots.size(); ++i) {
+        object *&obj = objects[slots[i]];
+        sum += obj->data[0];
+        alloc.deallocate(obj, 1);
+        obj = ::new(alloc.allocate(1)) object(long(i));
+    }
+    for (object *obj : objects)
+        alloc.deallocate(obj, 1);
+    return sum;
+}
+
+template <typename Pool>
+long churn_pool(const std::vector<std::size_t> &slots, std::size_t live) {
+    Pool pool;
+    std::vector<object *> objects(live);
+    for (std::size_t i = 0; i < live; ++i)
+        objects[i] = pool.alloc(long(i));
+    long sum = 0;
+    for (std::size_t i = 0; i < slots.size(); ++i) {
+        object *&obj = objects[slots[i]];
+        sum += obj->data[0];
+        pool.free(obj);
+        obj = pool.alloc(long(i));
+    }
+    for (object *obj : objects)
+        pool.free(obj);
+    return sum;
+}
+
+/**
+ * Same with random sizes from 8 to 256 bytes.
+ */
+template <typename Allocate, typename Deallocate>
+long churn_sizes(const std::vector<std::size_t> &slots, std::size_t live, Allocate allocate, Deallocate deallocate) {
+    std::vector<std::pair<char *, std::size_t>> blocks(live);
+    for (std::size_t i = 0; i < live; ++i) {
+        std::size_t size = 8 + i % 249;
+        blocks[i] = {static_cast<char *>(allocate(size)), size};
+        blocks[i].first[0] = char(i);
+    }
+    long sum = 0;
+    for (std::size_t i = 0; i < slots.size(); ++i) {
+        auto &block = blocks[slots[i]];
+        sum += block.first[0];
+        deallocate(block.first, block.second);
+        block.second = 8 + slots[(i + 1) % slots.size()] % 249;
+        block.first = static_cast<char *>(allocate(block.second));
+        block.first[0] = char(i);
+    }
+    for (auto &block : blocks)
+        deallocate(block.first, block.second);
+    return sum;
+}
+
+/**
+ * Allocate many objects, free them all, then allocate as many again.
+ */
+template <template <typename> class Alloc>
+long burst(std::size_t count) {
+    Alloc<object> alloc;
+    std::vector<object *> objects(count);
+    long sum = 0;
+    for (int round = 0; round < 2; ++round) {
+        for (std::size_t i = 0; i < count; ++i)
+            objects[i] = ::new(alloc.allocate(1)) object(long(i));
+        for (object *obj : objects) {
+            sum += obj->data[0];
+            alloc.deallocate(obj, 1);
+        }
+    }
+    return sum;
+}
+
+template <typename F>
+void in_threads(unsigned count, F f) {
+    std::vector<std::thread> threads;
+    for (unsigned i = 0; i < count; ++i)
+        threads.emplace_back(f);
+    for (std::thread &t : threads)
+        t.join();
+}
+
+template <typename T>
+using std_allocator = std::allocator<T>;
+
+/**
+ * Usage: benchmark-memory [steps] [live objects], 10000000 and 10000 by default.
+ */
+int main(int argc, const char **argv) {
+    std::size_t count = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 10000000;
+    std::size_t live = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 10000;
+    std::vector<std::size_t> slots = make_slots(count, live);
+    long sum = 0;
+
+    std::cout << "[Churn] std::allocator: " << mpp::timer::measure([&]() {
+        sum += churn<std::allocator>(slots, live);
+    }) << std::endl;
+    std::cout << "[Churn] mpp::slab_allocator: " << mpp::timer::measure([&]() {
+        sum += churn<mpp::slab_allocator>(slots, live);
+    }) << std::endl;
+    std::cout << "[Churn] mpp::allocator_type over std::allocator: " << mpp::timer::measure([&]() {
+        sum += churn_pool<mpp::allocator_type<object, 16, std_allocator>>(slots, live);
+    }) << std::endl;
+    std::cout << "[Churn] mpp::allocator_type over mpp::slab_allocator: " << mpp::timer::measure([&]() {
+        sum += churn_pool<mpp::allocator_type<object, 16>>(slots, live);
+    }) << std::endl;
+    std::cout << "[Churn] mpp::plain_allocator_type over std::allocator: " << mpp::timer::measure([&]() {
+        sum += churn_pool<mpp::plain_allocator_type<object, 16, std_allocator>>(slots, live);
+    }) << std::endl;
+    std::cout << "[Churn] mpp::plain_allocator_type over mpp::slab_allocator: " << mpp::timer::measure([&]() {
+        sum += churn_pool<mpp::plain_allocator_type<object, 16>>(slots, live);
+    }) << std::endl;
+
+    std::cout << std::endl;
+
+    std::cout << "[Mixed Sizes] ::operator new: " << mpp::timer::measure([&]() {
+        sum += churn_sizes(slots, live, [](std::size_t size) { return ::operator new(size); },
+                           [](void *ptr, std::size_t) { ::operator delete(ptr); });
+    }) << std::endl;
+    std::cout << "[Mixed Sizes] mpp::slab_heap: " << mpp::timer::measure([&]() {
+        sum += churn_sizes(slots, live, [](std::size_t size) { return mpp::slab_heap::allocate(size); },
+                           [](void *ptr, std::size_t size) { mpp::slab_heap::deallocate(ptr, size); });
+    }) << std::endl;
+
+    std::cout << std::endl;
+
+    std::cout << "[Burst] std::allocator: " << mpp::timer::measure([&]() {
+        sum += burst<std::allocator>(count / 10);
+    }) << std::endl;
+    std::cout << "[Burst] mpp::slab_allocator: " << mpp::timer::measure([&]() {
+        sum += burst<mpp::slab_allocator>(count / 10);
+    }) << std::endl;
+
+    std::cout << std::endl;
+
+    std::vector<std::size_t> thread_slots(slots.begin(), slots.begin() + count / 4);
+    std::cout << "[4 Threads] std::allocator: " << mpp::timer::measure([&]() {
+        in_threads(4, [&]() { churn<std::allocator>(thread_slots, live); });
+    }) << std::endl;
+    std::cout << "[4 Threads] mpp::slab_allocator: " << mpp::timer::measure([&]() {
+        in_threads(4, [&]() { churn<mpp::slab_allocator>(thread_slots, live); });
+    }) << std::endl;
+
+    return sum == 0 ? 1 : 0;
+}
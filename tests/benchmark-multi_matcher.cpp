@@ -0,0 +1,67 @@
+/**
+ * Mozart++ Template Library
+ * Licensed under Apache 2.0
+ * Copyright (C) 2020-2021 Chengdu Covariant Technologies Co., LTD.
+ * Website: https://covariant.cn/
+ * Github:  https://github.com/chengdu-zhirui/
+ */
+
+#include <mozart++/timer>
+#include <mozart++/multi_matcher>
+#include <iostream>
+#include <random>
+
+int test_epoch = 20;
+
+int main() {
+    std::vector<mpp::string_ref> keywords{
+            "error", "warning", "fatal", "timeout", "refused", "denied", "overflow",
+            "segfault", "panic", "abort", "exception", "unreachable", "corrupt",
+            "deadlock", "retry", "dropped", "invalid", "missing", "leak", "oom",
+            "killed", "throttled", "unavailable", "expired", "mismatch", "crash",
+            "stalled", "backpressure", "rollback", "failover", "degraded", "unhealthy",
+    };
+
+    // about 8MB of log lines
+    std::mt19937 rng(1);
+    const char *words[] = {"INFO ", "request ", "from ", "127.0.0.1 ", "took ", "12ms ", "status ", "200\n",
+                           "user ", "login ", "GET ", "/index.html "};
+    std::string log;
+    while (log.size() < (8u << 20)) {
+        log += words[rng() % 12];
+        if (rng() % 1000 == 0) {
+            log += keywords[rng() % keywords.size()].str();
+        }
+    }
+    mpp::string_ref text(log);
+    mpp::multi_matcher matcher(keywords);
+
+    size_t expected = 0;
+    for (mpp::string_ref keyword : keywords) {
+        for (size_t pos = text.find(keyword); pos != mpp::string_ref::npos; pos = text.find(keyword, pos + 1)) {
+            ++expected;
+        }
+    }
+    if (matcher.find_all(text).size() != expected) {
+        std::cout << "Outputs mismatch: " << matcher.find_all(text).size() << " != " << expected << std::endl;
+        return 1;
+    }
+
+    size_t count = 0;
+    std::cout << "[MultiMatcher] string_ref::find per keyword: " << mpp::timer::measure([&]() {
+        for (int i = 0; i < test_epoch; ++i)
+            for (mpp::string_ref keyword : keywords)
+                for (size_t pos = text.find(keyword); pos != mpp::string_ref::npos; pos = text.find(keyword, pos + 1))
+                    ++count;
+    }) << std::endl;
+    std::cout << "[MultiMatcher] multi_matcher: " << mpp::timer::measure([&]() {
+        for (int i = 0; i < test_epoch; ++i)
+            matcher.for_each_match(text, [&count](const mpp::multi_matcher::match &) { ++count; });
+    }) << std::endl;
+    std::cout << "[MultiMatcher] multi_matcher (ignore case): " << mpp::timer::measure([&]() {
+        mpp::multi_matcher folded(keywords, true);
+        for (int i = 0; i < test_epoch; ++i)
+            folded.for_each_match(text, [&count](const mpp::multi_matcher::match &) { ++count; });
+    }) << std::endl;
+    return count == 0;
+}
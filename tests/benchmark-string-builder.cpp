@@ -0,0 +1,49 @@
+/**
+ * Mozart++ Template Library
+ * Licensed under Apache 2.0
+ * Copyright (C) 2020-2021 Chengdu Covariant Technologies Co., LTD.
+ * Website: https://covariant.cn/
+ * Github:  https://github.com/chengdu-zhirui/
+ */
+
+#include <mozart++/timer>
+#include <mozart++/string_builder>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+#define LINE_FORMAT "[{}] request {} from {} took {.3}ms, status {}\n"
+
+/**
+ * Usage: benchmark-string-builder [lines], 1000000 by default.
+ */
+int main(int argc, const char **argv) {
+    int lines = argc > 1 ? std::atoi(argv[1]) : 1000000;
+    mpp::string_ref host = "127.0.0.1";
+    size_t a = 0, b = 0, c = 0;
+
+    std::cout << "[Builder] std::string += mpp::format: " << mpp::timer::measure([&]() {
+        std::string out;
+        for (int i = 0; i < lines; ++i) {
+            out += mpp::format(LINE_FORMAT, "INFO", i, host.str(), 3.14159, 200);
+        }
+        a = out.size();
+    }) << std::endl;
+    std::cout << "[Builder] std::ostringstream: " << mpp::timer::measure([&]() {
+        std::ostringstream out;
+        for (int i = 0; i < lines; ++i) {
+            mpp_cached_format(LINE_FORMAT).format(out, "INFO", i, host, 3.14159, 200);
+        }
+        b = out.str().size();
+    }) << std::endl;
+    std::cout << "[Builder] mpp::string_builder: " << mpp::timer::measure([&]() {
+        mpp::string_builder out;
+        for (int i = 0; i < lines; ++i) {
+            mpp::format_to(out, mpp_cached_format(LINE_FORMAT), "INFO", i, host, 3.14159, 200);
+        }
+        c = out.str().size();
+    }) << std::endl;
+
+    return a == b && b == c ? 0 : 1;
+}
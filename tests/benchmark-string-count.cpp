@@ -0,0 +1,74 @@
+/**
+ * Mozart++ Template Library
+ * Licensed under Apache 2.0
+ * Copyright (C) 2020-2021 Chengdu Covariant Technologies Co., LTD.
+ * Website: https://covariant.cn/
+ * Github:  https://github.com/chengdu-zhirui/
+ */
+
+#include <mozart++/timer>
+#include <mozart++/string>
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+
+size_t scalar_count(mpp::string_ref str, char c) {
+    size_t count = 0;
+    for (char d : str) {
+        if (d == c) {
+            ++count;
+        }
+    }
+    return count;
+}
+
+size_t scalar_count(mpp::string_ref str, mpp::string_ref needle) {
+    size_t count = 0;
+    for (size_t i = 0; i + needle.size() <= str.size(); ++i) {
+        if (str.substr(i, needle.size()).equals(needle)) {
+            ++count;
+        }
+    }
+    return count;
+}
+
+/**
+ * Usage: benchmark-string-count [size in MB], 1024 by default.
+ */
+int main(int argc, const char **argv) {
+    size_t size = (argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1024) << 20;
+
+    std::mt19937 rng(1);
+    const char *words[] = {"INFO ", "request ", "from ", "127.0.0.1 ", "took ", "12ms ", "status ", "200\n"};
+    std::string text;
+    text.reserve(size + 16);
+    while (text.size() < size) {
+        text += words[rng() % 8];
+    }
+    mpp::string_ref ref(text);
+
+    size_t lines = 0;
+    std::cout << "[Count] scalar count('\\n'): " << mpp::timer::measure([&]() {
+        lines = scalar_count(ref, '\n');
+    }) << std::endl;
+    std::cout << "[Count] std::count('\\n'): " << mpp::timer::measure([&]() {
+        lines = static_cast<size_t>(std::count(ref.begin(), ref.end(), '\n'));
+    }) << std::endl;
+    std::cout << "[Count] string_ref::count('\\n'): " << mpp::timer::measure([&]() {
+        lines = ref.count('\n');
+    }) << std::endl;
+
+    size_t found = 0;
+    std::cout << "[Count] scalar count(\"status\"): " << mpp::timer::measure([&]() {
+        found = scalar_count(ref, "status");
+    }) << std::endl;
+    std::cout << "[Count] string_ref::count(\"status\"): " << mpp::timer::measure([&]() {
+        found = ref.count("status");
+    }) << std::endl;
+    std::cout << "[Count] string_ref::count(\"status\", non-overlapping): " << mpp::timer::measure([&]() {
+        found = ref.count("status", false);
+    }) << std::endl;
+
+    return lines == 0 || found == 0;
+}
@@ -0,0 +1,62 @@
+/**
+ * Mozart++ Template Library
+ * Licensed under Apache 2.0
+ * Copyright (C) 2020-2021 Chengdu Covariant Technologies Co., LTD.
+ * Website: https://covariant.cn/
+ * Github:  https://github.com/chengdu-zhirui/
+ */
+
+#include <mozart++/timer>
+#include <mozart++/string>
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <numeric>
+#include <random>
+#include <string>
+#include <vector>
+
+/**
+ * Usage: benchmark-string-numeric [count], 1000000 by default.
+ */
+int main(int argc, const char **argv) {
+    size_t count = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1000000;
+
+    std::mt19937 rng(1);
+    const char *dirs[] = {"build/", "release/", "src/module/", "assets/textures/"};
+    std::vector<std::string> names;
+    names.reserve(count);
+    for (size_t i = 0; i != count; ++i) {
+        names.push_back(std::string(dirs[rng() % 4]) + "file-" + std::to_string(rng() % 100000)
+                        + "-v" + std::to_string(rng() % 20) + "." + std::string(rng() % 3, '0')
+                        + std::to_string(rng() % 200) + ".tar.gz");
+    }
+
+    std::vector<mpp::string_ref> by_compare(names.begin(), names.end());
+    std::cout << "[Numeric] std::sort with compare_numeric: " << mpp::timer::measure([&]() {
+        std::sort(by_compare.begin(), by_compare.end(), [](mpp::string_ref a, mpp::string_ref b) {
+            return a.compare_numeric(b) < 0;
+        });
+    }) << std::endl;
+
+    std::vector<size_t> by_key(count);
+    std::cout << "[Numeric] std::sort with numeric_key: " << mpp::timer::measure([&]() {
+        std::vector<std::string> keys;
+        keys.reserve(count);
+        for (const std::string &name : names) {
+            keys.push_back(mpp::string_ref(name).numeric_key());
+        }
+        std::iota(by_key.begin(), by_key.end(), size_t(0));
+        std::sort(by_key.begin(), by_key.end(), [&keys](size_t a, size_t b) {
+            return keys[a] < keys[b];
+        });
+    }) << std::endl;
+
+    for (size_t i = 0; i != count; ++i) {
+        if (!by_compare[i].equals(names[by_key[i]])) {
+            std::cout << "Orders mismatch at " << i << std::endl;
+            return 1;
+        }
+    }
+    return 0;
+}
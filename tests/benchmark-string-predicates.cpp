@@ -0,0 +1,71 @@
+/**
+ * Mozart++ Template Library
+ * Licensed under Apache 2.0
+ * Copyright (C) 2020-2021 Chengdu Covariant Technologies Co., LTD.
+ * Website: https://covariant.cn/
+ * Github:  https://github.com/chengdu-zhirui/
+ */
+
+#include <mozart++/timer>
+#include <mozart++/string>
+#include <cctype>
+#include <iostream>
+#include <random>
+
+int test_epoch = 200;
+
+/**
+ * Count the tokens (runs of alnum) in the text.
+ */
+template <typename Space, typename Word>
+size_t tokenize(mpp::string_ref text, Space space, Word word) {
+    size_t tokens = 0;
+    while (!(text = text.drop_while(space)).empty()) {
+        mpp::string_ref token = text.take_while(word);
+        if (token.empty()) {
+            token = text.take_front();
+        }
+        text = text.drop_front(token.size());
+        ++tokens;
+    }
+    return tokens;
+}
+
+int main() {
+    // identifiers and numbers separated by runs of spaces, like aligned tables
+    std::mt19937 rng(1);
+    std::string text;
+    while (text.size() < (1u << 20)) {
+        text.append(rng() % 16 + 1, ' ');
+        text.append(rng() % 24 + 1, "a0"[rng() % 2]);
+    }
+
+    mpp::function<bool(char)> function_space = [](char c) { return std::isspace(static_cast<unsigned char>(c)) != 0; };
+    mpp::function<bool(char)> function_word = [](char c) { return std::isalnum(static_cast<unsigned char>(c)) != 0; };
+    auto lambda_space = [](char c) { return c == ' ' || static_cast<unsigned char>(c - '\t') < 5; };
+    auto lambda_word = [](char c) { return static_cast<unsigned char>((c | 0x20) - 'a') < 26
+                                           || static_cast<unsigned char>(c - '0') < 10; };
+
+    size_t expected = tokenize(text, function_space, function_word);
+    if (tokenize(text, lambda_space, lambda_word) != expected
+        || tokenize(text, mpp::ascii_space(), mpp::ascii_alnum()) != expected) {
+        std::cout << "Outputs mismatch" << std::endl;
+        return 1;
+    }
+
+    size_t tokens = 0;
+    std::cout << "[Predicates] mpp::function: " << mpp::timer::measure([&]() {
+        for (int i = 0; i < test_epoch; ++i)
+            tokens += tokenize(text, function_space, function_word);
+    }) << std::endl;
+    std::cout << "[Predicates] lambda: " << mpp::timer::measure([&]() {
+        for (int i = 0; i < test_epoch; ++i)
+            tokens += tokenize(text, lambda_space, lambda_word);
+    }) << std::endl;
+    std::cout << "[Predicates] ascii classes: " << mpp::timer::measure([&]() {
+        for (int i = 0; i < test_epoch; ++i)
+            tokens += tokenize(text, mpp::ascii_space(), mpp::ascii_alnum());
+    }) << std::endl;
+
+    return tokens == 0;
+}
@@ -0,0 +1,567 @@
+/**
+ * Mozart++ Template Library
+ * Licensed under Apache 2.0
+ * Copyright (C) 2020-2021 Chengdu Covariant Technologies Co., LTD.
+ * Website: https://covariant.cn/
+ * Github:  https://github.com/chengdu-zhirui/
+ */
+
+#include <mozart++/any>
+#include <mozart++/string>
+#include <atomic>
+#include <cstdint>
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#define CHECK(cond) \
+    do { \
+        if (!(cond)) { \
+            printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+            ok = false; \
+        } \
+    } while (0)
+
+static int live_objects = 0;
+
+struct tracked {
+    std::string name;
+
+    explicit tracked(const char *n) : name(n) { ++live_objects; }
+
+    tracked(const tracked &other) : name(other.name) { ++live_objects; }
+
+    ~tracked() { --live_objects; }
+};
+
+// copies throw once copies_left reaches 0
+static int copies_left = -1;
+
+struct fragile {
+    int id;
+
+    explicit fragile(int i) : id(i) { ++live_objects; }
+
+    fragile(const fragile &other) : id(other.id) {
+        if (copies_left == 0)
+            throw std::runtime_error("fragile copy");
+        --copies_left;
+        ++live_objects;
+    }
+
+    ~fragile() { --live_objects; }
+};
+
+namespace user {
+    struct point {
+        int x, y;
+    };
+
+    struct padded {
+        char c;
+        int i;
+    };
+
+    struct named {
+        std::string name;
+    };
+
+    std::size_t hash_value(const named &n) {
+        return n.name.size();
+    }
+
+    struct custom {
+        int id;
+    };
+
+    enum class color {
+        red, green
+    };
+
+    enum class shape {
+        square, circle
+    };
+}
+
+namespace mpp {
+    template <>
+    struct hasher<user::custom> {
+        std::size_t operator()(const user::custom &c) const {
+            return 42 + c.id;
+        }
+    };
+}
+
+bool check_storage() {
+    bool ok = true;
+
+    static_assert(mpp::any::is_inline<int>(), "int must be stored inline");
+    static_assert(mpp::any::is_inline<double>(), "double must be stored inline");
+    static_assert(mpp::any::is_inline<const char *>(), "pointers must be stored inline");
+    static_assert(mpp::any::is_inline<mpp::string_ref>(), "string_ref must be stored inline");
+    static_assert(!mpp::any::is_inline<tracked>(), "non-trivial types go to the heap");
+
+    mpp::any empty;
+    CHECK(empty.empty() && empty.data_type() == typeid(void) && empty.hash() == 0);
+
+    mpp::any i(10);
+    mpp::any d(2.5);
+    mpp::any s(mpp::string_ref("view"));
+    CHECK(i.get<int>() == 10 && d.get<double>() == 2.5 && s.get<mpp::string_ref>().equals("view"));
+    CHECK(i.data_type() == typeid(int) && i.to_string() == "10");
+
+    bool thrown = false;
+    try {
+        i.get<long>();
+    } catch (const mpp::runtime_error &) {
+        thrown = true;
+    }
+    CHECK(thrown);
+
+    {
+        mpp::any t(tracked("heap"));
+        mpp::any u(t);
+        CHECK(live_objects == 2 && u.get<tracked>().name == "heap");
+        u = i;
+        CHECK(live_objects == 1 && u.get<int>() == 10);
+        mpp::any v(std::move(t));
+        CHECK(t.empty() && v.get<tracked>().name == "heap");
+        v.swap(i);
+        CHECK(v.get<int>() == 10 && i.get<tracked>().name == "heap");
+        i = 3;
+    }
+    CHECK(live_objects == 0 && i.get<int>() == 3);
+
+    std::vector<mpp::any> values{1, 2.0, std::string("three")};
+    std::vector<mpp::any> copies = values;
+    CHECK(copies[2].get<std::string>() == "three" && copies[0].hash() == values[0].hash());
+    return ok;
+}
+
+struct counted {
+    static int copies;
+    static int moves;
+    int value;
+
+    explicit counted(int v) : value(v) {}
+
+    counted(const counted &other) : value(other.value) { ++copies; }
+
+    counted(counted &&other) noexcept : value(other.value) { ++moves; }
+};
+
+int counted::copies = 0;
+int counted::moves = 0;
+
+bool check_move() {
+    bool ok = true;
+
+    static_assert(mpp::any::is_inline<counted>(), "nothrow movable small types are stored inline");
+
+    // moving a value in does not copy it
+    std::vector<int> vec(1000, 7);
+    const int *buffer = vec.data();
+    mpp::any a(std::move(vec));
+    CHECK(a.get<std::vector<int>>().data() == buffer);
+
+    std::string str(100, 'x');
+    a = std::move(str);
+    CHECK(a.get<std::string>() == std::string(100, 'x'));
+
+    // in-place construction
+    mpp::any b(mpp_impl::in_place_type<std::vector<int>>, 3, 1);
+    CHECK(b.get<std::vector<int>>() == std::vector<int>(3, 1));
+    std::string &s = b.emplace<std::string>(5, 'y');
+    CHECK(s == "yyyyy" && &s == &b.get<std::string>());
+
+    // moving an any relocates inline values with their move constructor
+    mpp::any c(counted(1));
+    counted::copies = counted::moves = 0;
+    mpp::any d(std::move(c));
+    mpp::any e;
+    e = std::move(d);
+    e.swap(c);
+    CHECK(counted::copies == 0 && counted::moves == 3 && c.get<counted>().value == 1 && e.empty());
+
+    // moving a heap value hands the pointer over
+    const std::vector<int> *heap = &b.emplace<std::vector<int>>(100, 2);
+    mpp::any f(std::move(b));
+    CHECK(b.empty() && &f.get<std::vector<int>>() == heap);
+
+    f.reset();
+    CHECK(f.empty());
+    return ok;
+}
+
+bool check_access() {
+    bool ok = true;
+
+    mpp::any empty;
+    mpp::any i(42);
+    const mpp::any s(std::string("str"));
+    CHECK(i.holds<int>() && !i.holds<long>() && !empty.holds<int>());
+    CHECK(i.tag() == mpp::any::tag_of<int>() && empty.tag() == nullptr && s.tag() != i.tag());
+
+    CHECK(i.try_get<int>() != nullptr && *i.try_get<int>() == 42);
+    CHECK(i.try_get<double>() == nullptr && empty.try_get<int>() == nullptr);
+    CHECK(s.try_get<std::string>() != nullptr && *s.try_get<std::string>() == "str");
+
+    ++i.get_unsafe<int>();
+    CHECK(i.get<int>() == 43 && s.get_unsafe<std::string>() == "str");
+
+    // dispatch on tags
+    int ints = 0, strings = 0;
+    std::vector<mpp::any> values{1, std::string("a"), 2, 3.0};
+    for (const mpp::any &value : values) {
+        if (value.tag() == mpp::any::tag_of<int>()) {
+            ints += value.get_unsafe<int>();
+        } else if (const std::string *str = value.try_get<std::string>()) {
+            strings += static_cast<int>(str->size());
+        }
+    }
+    CHECK(ints == 3 && strings == 1 && values[3].data_type() == typeid(double));
+    return ok;
+}
+
+bool check_visit() {
+    bool ok = true;
+    using numbers = mpp::typelist::list<int, double>;
+
+    std::vector<mpp::any> values{1, 2.5, std::string("abc"), mpp::any()};
+    double sum = 0;
+    int others = 0;
+    for (mpp::any &value : values) {
+        sum += mpp::visit<numbers>(value, [](auto &v) -> double { return v; },
+                                   [&others](mpp::any &) { ++others; return 0.0; });
+    }
+    CHECK(sum == 3.5 && others == 2);
+
+    // values are passed by reference, const for a const any
+    mpp::visit<mpp::typelist::list<std::string, int>>(values[2], [](auto &v) { v += v; });
+    const mpp::any &str = values[2];
+    std::size_t size = mpp::visit<mpp::typelist::list<std::string>>(str, [](auto &v) {
+        static_assert(std::is_const<std::remove_reference_t<decltype(v)>>::value, "const any gives const values");
+        return v.size();
+    });
+    CHECK(size == 6);
+
+    // the first listed type wins, unlisted types throw without a fallback
+    int which = mpp::visit<mpp::typelist::list<int, int>>(values[0], [](int v) { return v; });
+    CHECK(which == 1);
+    bool thrown = false;
+    try {
+        mpp::visit<numbers>(values[3], [](auto &) {});
+    }
+    catch (const mpp::runtime_error &) {
+        thrown = true;
+    }
+    CHECK(thrown);
+    return ok;
+}
+
+bool check_hash() {
+    bool ok = true;
+
+    static_assert(mpp::type_hash<int>::value != mpp::type_hash<long>::value, "types hash apart");
+    static_assert(mpp::type_hash<user::color>::value != mpp::type_hash<user::shape>::value, "types hash apart");
+
+    // integers are mixed into distinct, well spread values
+    std::set<std::size_t> hashes, low_bits;
+    for (int i = 0; i < 4096; ++i) {
+        std::size_t h = mpp::any(i * 1024).hash();
+        hashes.insert(h);
+        low_bits.insert(h & 4095);
+    }
+    CHECK(hashes.size() == 4096 && low_bits.size() > 2400);
+
+    // equal values of different types hash apart
+    CHECK(mpp::any(1).hash() != mpp::any(1L).hash());
+    CHECK(mpp::any(user::color::green).hash() != mpp::any(user::shape::circle).hash());
+    CHECK(mpp::hash(user::color::green) != mpp::hash(user::color::red));
+
+    // padding-free structs are hashed by bytes, padded ones can not be
+    CHECK(mpp::hash(user::point{1, 2}) == mpp::hash(user::point{1, 2}));
+    CHECK(mpp::hash(user::point{1, 2}) != mpp::hash(user::point{2, 1}));
+    CHECK(mpp::hash(user::padded{'a', 1}) == 0 && mpp::any(user::padded{'a', 1}).hash() != 0);
+
+    // customization points
+    CHECK(mpp::hash(user::named{"abc"}) == mpp::hash_mix(3));
+    CHECK(mpp::hash(user::custom{1}) == 43);
+    CHECK(mpp::any(user::custom{1}).hash() == mpp::hash_combine(mpp::type_hash<user::custom>::value, 43));
+    CHECK(mpp::hash_combine(1, 2) != mpp::hash_combine(2, 1));
+    return ok;
+}
+
+bool check_any_ref() {
+    bool ok = true;
+
+    // referring
+    mpp::any original(1);
+    mpp::any_ref ref(original);
+    ref.get() = 2;
+    mpp::any_ref ref_copy(ref);
+    CHECK(ref.is_ref() && original.get<int>() == 2 && &ref_copy.get() == &original);
+
+    // owning inline
+    {
+        mpp::any_ref owned(mpp::any(tracked("inline")));
+        mpp::any_ref copy(owned);
+        CHECK(live_objects == 2 && !owned.is_ref() && &copy.get() != &owned.get());
+        mpp::any_ref moved(std::move(owned));
+        CHECK(owned.empty() && moved.get().get<tracked>().name == "inline");
+        copy = moved;
+        CHECK(live_objects == 2);
+
+        // constant anys are copied
+        const mpp::any constant(tracked("constant"));
+        mpp::any_ref copied(constant);
+        CHECK(live_objects == 4 && !copied.is_ref() && &copied.get() != &constant);
+    }
+    CHECK(live_objects == 0);
+
+    // owning in an arena: the anys are destroyed with their handles,
+    // their memory goes with the arena
+    mpp::arena_allocator arena;
+    {
+        std::vector<mpp::any_ref> scratch;
+        for (int i = 0; i < 100; ++i)
+            scratch.emplace_back(mpp::any(tracked("arena")), arena);
+        mpp::any_ref copy(scratch.front());
+        scratch.emplace_back(original, arena);
+        CHECK(live_objects == 101 && !copy.is_ref() && &copy.get() != &scratch.front().get());
+        CHECK(scratch.back().get().get<int>() == 2 && &scratch.back().get() != &original);
+        copy = ref;
+        CHECK(live_objects == 100 && copy.is_ref());
+    }
+    CHECK(live_objects == 0 && arena.allocated_bytes() > 0);
+    arena.release();
+
+    bool thrown = false;
+    try {
+        mpp::any_ref().get();
+    } catch (const mpp::runtime_error &) {
+        thrown = true;
+    }
+    CHECK(thrown);
+    return ok;
+}
+
+bool check_any_vector() {
+    bool ok = true;
+
+    {
+        mpp::any_vector values(256);
+        values.push_back(1);
+        values.push_back(2);
+        values.push_back(std::string("three"));
+        values.emplace_back<tracked>("four");
+        values.push_back(5.5);
+        for (int i = 6; i < 1000; ++i)
+            values.push_back(i);
+        CHECK(values.size() == 999 && values.runs().size() == 5 && live_objects == 1);
+        CHECK(values.get<int>(0) == 1 && values.get<std::string>(2) == "three" && values.get<double>(4) == 5.5);
+        CHECK(values.holds<tracked>(3) && values.try_get<int>(3) == nullptr && !values.holds<int>(999));
+        CHECK(values.tag(1) == mpp::any::tag_of<int>() && values.data_type(2) == typeid(std::string));
+        CHECK(values.at(2).get<std::string>() == "three" && values.at(998).get<int>() == 999);
+
+        bool thrown = false;
+        try {
+            values.get<long>(0);
+        } catch (const mpp::runtime_error &) {
+            thrown = true;
+        }
+        CHECK(thrown);
+
+        // values are packed and aligned
+        CHECK(reinterpret_cast<std::uintptr_t>(&values.get<double>(4)) % alignof(double) == 0);
+        CHECK(&values.get<int>(1) == &values.get<int>(0) + 1);
+
+        long sum = 0;
+        values.for_each<int>([&](size_t index, int &value) {
+            sum += value;
+            CHECK(index + 1 == static_cast<size_t>(value));
+        });
+        CHECK(sum == 3 + 999L * 1000 / 2 - 15);
+
+        std::vector<std::size_t> hashes(values.size());
+        std::vector<std::string> strings(values.size());
+        values.hash_all(hashes.data());
+        values.to_string_all(strings.data());
+        for (size_t i = 0; i < values.size(); ++i) {
+            CHECK(hashes[i] == values.at(i).hash() && strings[i] == values.at(i).to_string());
+            CHECK(hashes[i] == values.hash(i) && strings[i] == values.to_string(i));
+        }
+
+        mpp::any_vector copy(values);
+        values.pop_back();
+        values.get<std::string>(2) += "!";
+        CHECK(copy.size() == 999 && values.size() == 998 && copy.get<std::string>(2) == "three");
+        CHECK(live_objects == 2 && copy.runs().size() == 5);
+
+        mpp::any_vector moved(std::move(copy));
+        CHECK(copy.empty() && moved.get<int>(998) == 999);
+
+        mpp::any_vector small;
+        small.push_back(1);
+        small.push_back(2L);
+        CHECK(small.to_string() == "{1, 2}");
+
+        // the room of a popped value is reused
+        const long *last = &small.get<long>(1);
+        small.pop_back();
+        small.push_back(3L);
+        CHECK(&small.get<long>(1) == last);
+    }
+    CHECK(live_objects == 0);
+
+    {
+        // the buffer grows with values of the vector as arguments
+        mpp::any_vector strings;
+        strings.push_back(std::string(100, 's'));
+        for (int i = 0; i < 100; ++i)
+            strings.push_back(strings.get<std::string>(i));
+        CHECK(strings.size() == 101 && strings.get<std::string>(100) == std::string(100, 's'));
+        CHECK(&strings.get<std::string>(1) == &strings.get<std::string>(0) + 1);
+    }
+
+    {
+        // copies throwing partway leave nothing behind
+        mpp::any_vector values;
+        for (int i = 0; i < 10; ++i) {
+            values.emplace_back<fragile>(i);
+            values.push_back(i);
+        }
+        copies_left = 5;
+        bool thrown = false;
+        try {
+            mpp::any_vector copy(values);
+        } catch (const std::runtime_error &) {
+            thrown = true;
+        }
+        CHECK(thrown && live_objects == 10);
+
+        // and the values stay where they were if growing throws
+        copies_left = 3;
+        thrown = false;
+        try {
+            for (int i = 0; i < 1000; ++i)
+                values.push_back(i);
+        } catch (const std::runtime_error &) {
+            thrown = true;
+        }
+        copies_left = -1;
+        CHECK(thrown && live_objects == 10 && values.get<fragile>(18).id == 9 && values.get<int>(19) == 9);
+    }
+    CHECK(live_objects == 0);
+    return ok;
+}
+
+/**
+ * Values allocated on producer threads are destroyed on consumer threads,
+ * so most blocks are freed by another thread than the allocating one.
+ * Best run under ThreadSanitizer as well.
+ */
+bool check_threads() {
+    bool ok = true;
+    const int producers = 4, consumers = 4, messages = 20000;
+
+    std::mutex mutex;
+    std::condition_variable ready;
+    std::deque<mpp::any> queue;
+    std::atomic<int> received{0};
+    std::atomic<long> total{0};
+    int finished = 0;
+
+    std::vector<std::thread> threads;
+    for (int p = 0; p < producers; ++p) {
+        threads.emplace_back([&, p]() {
+            for (int i = 0; i < messages; ++i) {
+                mpp::any value;
+                if (i % 2 == 0)
+                    value = std::string(40 + i % 7, 'a');
+                else
+                    value = std::vector<int>(i % 5 + 1, p);
+                // allocations and frees on this thread too
+                mpp::any scratch(std::string(64, 'x'));
+                std::lock_guard<std::mutex> lock(mutex);
+                queue.push_back(std::move(value));
+                ready.notify_one();
+            }
+            std::lock_guard<std::mutex> lock(mutex);
+            ++finished;
+            ready.notify_all();
+        });
+    }
+    for (int c = 0; c < consumers; ++c) {
+        threads.emplace_back([&]() {
+            while (true) {
+                mpp::any value;
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    ready.wait(lock, [&]() { return !queue.empty() || finished == producers; });
+                    if (queue.empty())
+                        return;
+                    value = std::move(queue.front());
+                    queue.pop_front();
+                }
+                if (const std::string *str = value.try_get<std::string>())
+                    total += static_cast<long>(str->size());
+                else
+                    total += static_cast<long>(value.get<std::vector<int>>().size());
+                ++received;
+            }
+        });
+    }
+    for (std::thread &thread : threads)
+        thread.join();
+
+    long expected = 0;
+    for (int i = 0; i < messages; ++i)
+        expected += i % 2 == 0 ? 40 + i % 7 : i % 5 + 1;
+    CHECK(received == producers * messages && total == expected * producers);
+
+    // the blocks freed by the threads are reused here
+    std::vector<mpp::any> values;
+    for (int i = 0; i < 1000; ++i)
+        values.emplace_back(std::string(50, 'z'));
+    CHECK(values.back().get<std::string>().size() == 50);
+    return ok;
+}
+
+bool check_reuse() {
+    bool ok = true;
+
+    // a burst of frees, then as many allocations: the freed blocks
+    // are taken back rather than new chunks
+    std::vector<mpp::any> values;
+    std::size_t peak = 0;
+    for (int round = 0; round < 2; ++round) {
+        for (int i = 0; i < 400000; ++i)
+            values.emplace_back(std::string(40, 'a' + round));
+        CHECK(values.back().get<std::string>()[0] == 'a' + round);
+        if (round == 0)
+            peak = mpp::slab_heap::page_count();
+        CHECK(mpp::slab_heap::page_count() <= peak);
+        values.clear();
+    }
+    return ok;
+}
+
+int main() {
+    bool ok = check_storage();
+    ok = check_access() && ok;
+    ok = check_visit() && ok;
+    ok = check_hash() && ok;
+    ok = check_any_ref() && ok;
+    ok = check_any_vector() && ok;
+    ok = check_threads() && ok;
+    ok = check_reuse() && ok;
+    ok = check_move() && ok;
+    return ok ? 0 : 1;
+}
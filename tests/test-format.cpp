@@ -13,6 +13,14 @@
 #include <deque>
 #include <list>
 #include <tuple>
+#include <sstream>
+#include <random>
+#include <cstring>
+#include <cstdio>
+#include <cmath>
+#include <iomanip>
+#include <locale>
+#include <initializer_list>
 
 struct obj {
     int a = 0;
@@ -36,6 +44,39 @@ std::string mpp::to_string(const objx &val) {
     return mpp::format("objxToString{a: {}, b: {}}", val.a, val.b);
 }
 
+struct amount {
+    int value;
+};
+
+std::ostream &operator<<(std::ostream &out, const amount &a) {
+    return out << a.value;
+}
+
+struct thousands : std::numpunct<char> {
+    char do_thousands_sep() const override {
+        return ',';
+    }
+
+    std::string do_grouping() const override {
+        return "\3";
+    }
+};
+
+/**
+ * User types are written to the target stream itself, with its locale.
+ */
+bool check_stream_locale() {
+    std::ostringstream out;
+    out.imbue(std::locale(out.getloc(), new thousands));
+    std::ios_base::fmtflags flags = out.flags();
+    mpp::format(out, "[{}] [{:12|*}] [{x}] {}", amount{1234567}, amount{1234567}, amount{255}, 7);
+    if (out.str() != "[1,234,567] [***1,234,567] [0xff] 7" || out.flags() != flags) {
+        printf("stream locale mismatch: %s\n", out.str().c_str());
+        return false;
+    }
+    return true;
+}
+
 class only_string_writable {
 public:
 
@@ -46,9 +87,384 @@ only_string_writable &operator<<(only_string_writable &out, const std::string &s
     return out;
 }
 
+std::string printf_string(const char *conv, int precision, double value) {
+    int length = std::snprintf(nullptr, 0, conv, precision, value);
+    std::string result(length + 1, '\0');
+    std::snprintf(&result[0], result.size(), conv, precision, value);
+    result.resize(length);
+    return result;
+}
+
+/**
+ * Write the manipulators and the value to the stream as one placeholder
+ * does: the flags are restored afterwards, the fill and precision are not.
+ */
+template <typename ...Ts>
+void put(std::ostream &out, const Ts &... ts) {
+    std::ios_base::fmtflags flags = out.flags();
+    (void) std::initializer_list<int>{(out << ts, 0)...};
+    out.flags(flags);
+}
+
+/**
+ * Narrow signed integers in every integer form, against std::ostream.
+ */
+template <typename T>
+bool check_narrow(T value) {
+    std::ostringstream expected;
+    put(expected, value);
+    expected << ' ';
+    put(expected, std::showbase, std::dec, value);
+    expected << ' ';
+    put(expected, std::showbase, std::hex, value);
+    expected << ' ';
+    put(expected, std::showbase, std::oct, value);
+    expected << " [";
+    put(expected, std::right, std::setw(6), value);
+    expected << "] [";
+    put(expected, std::showbase, std::hex, std::left, std::setw(8), value);
+    expected << "]";
+
+    std::string actual = mpp::format("{} {d} {x} {o} [{:6}] [{x:-8}]", value, value, value, value, value, value);
+    if (actual != expected.str()) {
+        printf("narrow integer mismatch: [%s] != [%s]\n", actual.c_str(), expected.str().c_str());
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Compare the native number conversions of char_buffer against
+ * printf and std::ostream with random values.
+ */
+bool check_numbers() {
+    std::mt19937_64 rng(20201017);
+    bool ok = true;
+    const char *convs[] = {"%.*f", "%.*e", "%.*g", "%.*a"};
+    // fixed and scientific flags of each style
+    bool styles[][2] = {{true, false}, {false, true}, {false, false}, {true, true}};
+
+    for (int i = 0; i < 20000; ++i) {
+        double value;
+        if (i % 2 == 0) {
+            std::uint64_t bits = rng();
+            std::memcpy(&value, &bits, sizeof(value));
+        } else {
+            // values people actually print
+            value = static_cast<double>(rng() % 2000000) / std::pow(10.0, static_cast<int>(rng() % 12)) - 1000.0;
+        }
+        int precision = static_cast<int>(rng() % 18);
+        size_t style = rng() % 4;
+        if (style == 0 && std::fabs(value) > 1e60) {
+            // keep the fixed output short, long ones are checked below
+            style = 1;
+        }
+
+        mpp::char_buffer buffer;
+        mpp::char_buffer::fmtflags flags;
+        flags.fixed = styles[style][0];
+        flags.scientific = styles[style][1];
+        buffer.flags(flags);
+        buffer.precision(precision);
+        buffer << value;
+        // hexfloat ignores the precision, like std::ostream
+        std::string expected = printf_string(convs[style], style == 3 ? -1 : precision, value);
+        if (buffer.str() != expected) {
+            printf("number mismatch: [%s] != [%s]\n", buffer.str().c_str(), expected.c_str());
+            ok = false;
+        }
+    }
+
+    for (double value : {1e300, -1.7976931348623157e308, 4.9406564584124654e-324, 0.1, 2.5, 0.5, 1.5}) {
+        for (int precision : {0, 1, 6, 20, 400}) {
+            mpp::char_buffer buffer;
+            mpp::char_buffer::fmtflags flags;
+            flags.fixed = true;
+            buffer.flags(flags);
+            buffer.precision(precision);
+            buffer << value;
+            std::string expected = printf_string("%.*f", precision, value);
+            if (buffer.str() != expected) {
+                printf("number mismatch: [%s] != [%s]\n", buffer.str().c_str(), expected.c_str());
+                ok = false;
+            }
+        }
+    }
+
+    for (int i = 0; i < 20000; ++i) {
+        std::ostringstream expected;
+        mpp::char_buffer buffer;
+        auto (*base)(std::ios_base &) -> std::ios_base & = i % 3 == 0 ? std::hex : i % 3 == 1 ? std::oct : std::dec;
+        expected << base << std::showbase << std::setw(static_cast<int>(rng() % 24)) << std::setfill('_');
+        mpp::char_buffer::fmtflags flags;
+        flags.base = i % 3 == 0 ? 16 : i % 3 == 1 ? 8 : 10;
+        flags.showbase = true;
+        buffer.flags(flags);
+        buffer.width(static_cast<int>(expected.width()));
+        buffer.fill('_');
+        if (i % 2 == 0) {
+            long long value = static_cast<long long>(rng()) >> (rng() % 64);
+            expected << value;
+            buffer << value;
+        } else {
+            int value = static_cast<int>(rng() >> (rng() % 64));
+            expected << value;
+            buffer << value;
+        }
+        if (buffer.str() != expected.str()) {
+            printf("integer mismatch: [%s] != [%s]\n", buffer.str().c_str(), expected.str().c_str());
+            ok = false;
+        }
+    }
+
+    for (int value : {-3, -42, -128, -32768, 0, 7}) {
+        ok = check_narrow(static_cast<short>(value)) && ok;
+        ok = check_narrow(static_cast<signed char>(value)) && ok;
+    }
+    return ok;
+}
+
 class nothing_writable {
 };
 
+/**
+ * Format to a stream prepared by setup, against the same kind of stream
+ * written by hand, which must end up in the same state too.
+ */
+template <typename Setup, typename Expected, typename ...Args>
+bool check_stream(Setup setup, Expected expected, const std::string &fmt, Args &&... args) {
+    std::ostringstream actual, by_hand;
+    setup(actual);
+    setup(by_hand);
+    mpp::format(actual, fmt, args...);
+    expected(by_hand);
+    if (actual.str() != by_hand.str() || actual.flags() != by_hand.flags()
+        || actual.fill() != by_hand.fill() || actual.precision() != by_hand.precision()) {
+        printf("stream mismatch: [%s] != [%s]\n", actual.str().c_str(), by_hand.str().c_str());
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Format to a default stream and to a string, against a default
+ * stream written by hand.
+ */
+template <typename Expected, typename ...Args>
+bool check_default(Expected expected, const std::string &fmt, Args &&... args) {
+    std::ostringstream by_hand;
+    expected(by_hand);
+    std::string actual = mpp::format(fmt, args...);
+    if (actual != by_hand.str()) {
+        printf("string mismatch: [%s] != [%s]\n", actual.c_str(), by_hand.str().c_str());
+        return false;
+    }
+    return check_stream([](std::ostream &) {}, expected, fmt, args...);
+}
+
+/**
+ * Placeholders against the manipulators they stand for, on default
+ * streams and on streams with formatting state already set.
+ */
+bool check_streams() {
+    bool ok = true;
+    ok = check_default([](std::ostream &os) {
+        put(os, std::showbase, std::hex, 255);
+        os << ' ';
+        put(os, std::showbase, std::oct, 8);
+        os << ' ';
+        put(os, std::showbase, std::dec, -10);
+        os << ' ';
+        put(os, std::showbase, std::hex, -1);
+        os << ' ';
+        put(os, std::showbase, std::oct, (short) -1);
+    }, "{x} {o} {d} {x} {o}", 255, 8, -10, -1, (short) -1) && ok;
+
+    ok = check_default([](std::ostream &os) {
+        put(os, std::showbase, std::hex, 0);
+        os << ' ';
+        put(os, std::showbase, std::oct, 0);
+        os << ' ';
+        put(os, std::showbase, std::hex, 123456789012345LL);
+        os << ' ';
+        put(os, 18446744073709551615ULL);
+        os << ' ';
+        put(os, true);
+    }, "{x} {o} {x} {} {}", 0, 0, 123456789012345LL, 18446744073709551615ULL, true) && ok;
+
+    ok = check_default([](std::ostream &os) {
+        put(os, 'c');
+        os << ' ';
+        put(os, (unsigned char) 'u');
+        os << ' ';
+        put(os, (signed char) 's');
+        os << ' ';
+        put(os, std::right, std::setw(3), 'w');
+    }, "{} {} {} {:3}", 'c', (unsigned char) 'u', (signed char) 's', 'w') && ok;
+
+    ok = check_default([](std::ostream &os) {
+        put(os, 0.1);
+        os << ' ';
+        put(os, 1e100);
+        os << ' ';
+        put(os, -0.0);
+        os << ' ';
+        put(os, 123456789.0);
+    }, "{} {} {} {}", 0.1, 1e100, -0.0, 123456789.0) && ok;
+
+    // the precision is kept for the following placeholders
+    ok = check_default([](std::ostream &os) {
+        put(os, std::fixed, std::setprecision(2), 3.14159);
+        os << ' ';
+        put(os, 2.71828);
+        os << ' ';
+        put(os, std::fixed, std::setprecision(0), 2.5);
+        os << ' ';
+        put(os, std::scientific, 15.0);
+        os << ' ';
+        put(os, std::fixed, std::setprecision(3), std::scientific, 1e-10);
+        os << ' ';
+        put(os, std::showbase, std::hex, std::hexfloat, 15.0);
+    }, "{.2} {} {.0} {e} {.3e} {x}", 3.14159, 2.71828, 2.5, 15.0, 1e-10, 15.0) && ok;
+
+    ok = check_default([](std::ostream &os) {
+        put(os, std::fixed, std::setprecision(2), 1e300);
+        os << ' ';
+        put(os, std::fixed, std::setprecision(2), std::showbase, std::hex, std::hexfloat,
+            std::right, std::setw(30), std::setfill('*'), 3.14);
+        os << ' ';
+        put(os, 3.0L);
+    }, "{.2} {.2x:30|*} {}", 1e300, 3.14, 3.0L) && ok;
+
+    // so is the fill
+    ok = check_default([](std::ostream &os) {
+        os << '[';
+        put(os, std::left, std::setw(10), std::setfill('='), 10);
+        os << "] [";
+        put(os, std::right, std::setw(10), "str");
+        os << "] [";
+        put(os, std::right, std::setw(5), std::setfill('0'), std::string("ab"));
+        os << "] [";
+        put(os, std::left, std::setw(8), -12);
+        os << ']';
+    }, "[{:-10|=}] [{:10}] [{:5|0}] [{:-8}]", 10, "str", std::string("ab"), -12) && ok;
+
+    ok = check_default([](std::ostream &os) {
+        os << '[';
+        put(os, std::showbase, std::hex, std::left, std::setw(8), std::setfill('_'), 255);
+        os << "] [";
+        put(os, std::showbase, std::oct, std::right, std::setw(8), 8);
+        os << "] [";
+        put(os, std::right, std::setw(4), "ref");
+        os << ']';
+    }, "[{x:-8|_}] [{o:8}] [{:4}]", 255, 8, mpp::string_ref("ref")) && ok;
+
+    ok = check_default([](std::ostream &os) {
+        put(os, std::right, std::setw(20), objx{1, 2});
+        os << ' ';
+        put(os, mpp::to_string(obj{}));
+    }, "{:20} {}", objx{1, 2}, obj{}) && ok;
+
+    // the width applies to the first char written
+    ok = check_default([](std::ostream &os) {
+        put(os, std::right, std::setw(8), '(');
+        os << "1, a) {1, 2.5, c} {1, 2, 3}";
+    }, "{:8} {} {}", std::make_pair(1, "a"), std::make_tuple(1, 2.5, 'c'), std::vector<int>{1, 2, 3}) && ok;
+
+    ok = check_stream([](std::ostream &os) { os << std::hex << std::setfill('.') << std::setprecision(3) << std::left; },
+        [](std::ostream &os) {
+            put(os, 255);
+            os << " [";
+            put(os, std::right, std::setw(6), 10);
+            os << "] ";
+            put(os, 2.71828);
+            os << ' ';
+            put(os, std::showbase, std::dec, 20);
+            os << ' ';
+            put(os, std::fixed, std::setprecision(1), 1.25);
+        }, "{} [{:6}] {} {d} {.1}", 255, 10, 2.71828, 20, 1.25) && ok;
+
+    ok = check_stream([](std::ostream &os) { os << std::showbase << std::oct << std::fixed << std::setw(5); },
+        [](std::ostream &os) {
+            put(os, 8);
+            os << '|';
+            put(os, std::showbase, std::hex, 255);
+            os << '|';
+            put(os, 0.5);
+        }, "{}|{x}|{}", 8, 255, 0.5) && ok;
+
+    ok = check_stream([](std::ostream &os) { os << std::scientific << std::setprecision(2) << std::left << std::setw(10); },
+        [](std::ostream &os) {
+            put(os, 1234.5);
+            os << ' ';
+            put(os, std::left, std::setw(6), std::setfill('_'), "ab");
+        }, "{} {:-6|_}", 1234.5, "ab") && ok;
+    return ok;
+}
+
+/**
+ * Flags and locales of the target stream that char_buffer does not keep.
+ */
+bool check_stream_flags() {
+    bool ok = true;
+    ok = check_stream([](std::ostream &os) { os << std::boolalpha << std::showpos; }, [](std::ostream &os) {
+        put(os, true);
+        os << ' ';
+        put(os, 5);
+        os << ' ';
+        put(os, std::fixed, std::setprecision(2), 2.5);
+        os << " [";
+        put(os, std::right, std::setw(6), -3);
+        os << "] [";
+        put(os, std::right, std::setw(8), amount{5});
+        os << ']';
+    }, "{} {} {.2} [{:6}] [{:8}]", true, 5, 2.5, -3, amount{5}) && ok;
+
+    ok = check_stream([](std::ostream &os) { os << std::uppercase; }, [](std::ostream &os) {
+        put(os, std::showbase, std::hex, 255);
+        os << ' ';
+        put(os, std::scientific, 1.5);
+        os << ' ';
+        put(os, std::showbase, std::hex, std::hexfloat, 10.0);
+    }, "{x} {e} {x}", 255, 1.5, 10.0) && ok;
+
+    ok = check_stream([](std::ostream &os) { os << std::showpoint; }, [](std::ostream &os) {
+        put(os, 2.0);
+        os << ' ';
+        put(os, std::fixed, std::setprecision(0), 3.0);
+    }, "{} {.0}", 2.0, 3.0) && ok;
+
+    ok = check_stream([](std::ostream &os) { os << std::internal << std::setfill('0') << std::setw(8); },
+        [](std::ostream &os) {
+            put(os, -42);
+            os << ' ';
+            put(os, 7);
+        }, "{} {}", -42, 7) && ok;
+
+    ok = check_stream([](std::ostream &os) { os.imbue(std::locale(os.getloc(), new thousands)); },
+        [](std::ostream &os) {
+            put(os, 1234567);
+            os << ' ';
+            put(os, std::showbase, std::hex, 255);
+            os << " [";
+            put(os, std::right, std::setw(12), std::setfill('*'), 1234567);
+            os << "] ";
+            put(os, std::fixed, std::setprecision(2), 1234.5);
+        }, "{} {x} [{:12|*}] {.2}", 1234567, 255, 1234567, 1234.5) && ok;
+    return ok;
+}
+
+template <typename ...Args>
+bool check_compiled(const std::string &fmt, Args &&... args) {
+    std::string expected = mpp::format(fmt, args...);
+    std::string actual = mpp::format(mpp::compiled_format(fmt), args...);
+    if (expected != actual) {
+        printf("compiled format mismatch: [%s] != [%s]\n", actual.c_str(), expected.c_str());
+        return false;
+    }
+    return true;
+}
+
 int main() {
     auto s = mpp::format("hello {} {} {}", 0.1 + 0.2);
     printf("%s\n", s.c_str());
@@ -122,5 +538,63 @@ int main() {
     mpp::format(std::cout,
         "in hex format, up to 2 floating points, right aligned to 4 {.2x:4}\n",
         3.14);
-    return 0;
+
+    bool ok = true;
+    ok &= check_compiled("hello {} {} {}", 0.1 + 0.2);
+    ok &= check_compiled("no placeholders");
+    ok &= check_compiled("no placeholders", 1, 2);
+    ok &= check_compiled("{}{}", 1, 2, 3);
+    ok &= check_compiled("an int inside a bracket {{}}", 100);
+    ok &= check_compiled("{x} {o} {d} {e} {.3} {.2e}", 255, 8, 10, 15.0, 3.14159, 2.5);
+    ok &= check_compiled("[{:-10|=}] [{:10|6}] [{:4}]", 10, 10, "ab");
+    ok &= check_compiled("[{:5|}}] [{:5|}] [{:} {.} {:-}]", 1, 2);
+    ok &= check_compiled("{} and {}", std::make_pair(1, 2), std::vector<int>{1, 2});
+
+    ok = check_streams() && ok;
+
+    static_assert(mpp::format_placeholders("{} {{}} {x} {.2e:-8|0} {:} {.}") == 4, "You wrote a bug");
+    static_assert(mpp::format_placeholders("no placeholders") == 0, "You wrote a bug");
+
+    std::string checked = mpp::format(mpp_format_string("[{}] {x} {.2:-8|_} {}!"), "s", 255, 3.14159, std::make_pair(1, 2));
+    if (checked != mpp::format("[{}] {x} {.2:-8|_} {}!", "s", 255, 3.14159, std::make_pair(1, 2))) {
+        printf("format string mismatch: %s\n", checked.c_str());
+        ok = false;
+    }
+    mpp::format(std::cout, mpp_format_string("checked {} {e}\n"), 1, 15.0);
+    mpp::format(std::cout, mpp_format_string("no arguments\n"));
+
+    mpp::char_buffer cb;
+    mpp::format_to(cb, "{} {}", 1, "two");
+    mpp::format_to(cb, mpp_cached_format(" {x}"), 255);
+    mpp::format_to(cb, mpp_format_string("{}"), "");
+    if (!cb.ref().equals("1 two 0xff")) {
+        printf("format_to mismatch: %s\n", cb.str().c_str());
+        ok = false;
+    }
+
+    char small[8];
+    auto result = mpp::format_to_n(small, sizeof(small), "{}-{}", 12345, 67890);
+    if (result.size != 11 || result.out != small + 8 || std::string(small, 8) != "12345-67") {
+        printf("format_to_n mismatch: %zu\n", result.size);
+        ok = false;
+    }
+
+    const char *null_str = nullptr;
+    std::ostringstream null_out;
+    mpp::format(null_out, "[{:4}]", null_str);
+    if (mpp::format("[{:4}]", null_str) != "[]" || null_out.str() != "[]") {
+        printf("null string mismatch: %s\n", null_out.str().c_str());
+        ok = false;
+    }
+
+    std::string buffer = "prefix ";
+    mpp_cached_format("{} + {} = {}").format_to(buffer, 1, 2, 3);
+    if (buffer != "prefix 1 + 2 = 3") {
+        printf("format_to mismatch: %s\n", buffer.c_str());
+        ok = false;
+    }
+    ok = check_numbers() && ok;
+    ok = check_stream_locale() && ok;
+    ok = check_stream_flags() && ok;
+    return ok ? 0 : 1;
 }
@@ -0,0 +1,158 @@
+/**
+ * Mozart++ Template Library
+ * Licensed under Apache 2.0
+ * Copyright (C) 2020-2021 Chengdu Covariant Technologies Co., LTD.
+ * Website: https://covariant.cn/
+ * Github:  https://github.com/chengdu-zhirui/
+ */
+
+#include <mozart++/memory>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <list>
+#include <map>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+using mpp::slab_heap;
+
+bool check(bool cond, const char *what) {
+    if (!cond)
+        printf("%s: failed\n", what);
+    return cond;
+}
+
+struct alignas(16) vec4 {
+    float v[4];
+};
+
+struct payload {
+    std::string text;
+    int &alive;
+
+    payload(const char *t, int &a) : text(t), alive(a) { ++alive; }
+
+    ~payload() { --alive; }
+};
+
+std::vector<void *> allocate_all(size_t count, size_t size) {
+    std::vector<void *> blocks(count);
+    for (size_t i = 0; i < count; ++i) {
+        blocks[i] = slab_heap::allocate(size);
+        std::memset(blocks[i], int(i), size);
+    }
+    return blocks;
+}
+
+void deallocate_all(const std::vector<void *> &blocks, size_t size) {
+    for (void *p : blocks)
+        slab_heap::deallocate(p, size);
+}
+
+int main() {
+    bool ok = true;
+
+    // objects of a class are packed in few chunks
+    size_t pages = slab_heap::page_count();
+    std::vector<void *> blocks = allocate_all(10000, 32);
+    size_t used = slab_heap::page_count() - pages;
+    ok = check(used >= 10000 * 32 / slab_heap::page_size && used <= 10000 * 32 / slab_heap::page_size * 11 / 10,
+               "packing") && ok;
+    ok = check(std::set<void *>(blocks.begin(), blocks.end()).size() == blocks.size(), "distinct") && ok;
+    bool aligned = true;
+    for (void *p : blocks)
+        aligned = aligned && reinterpret_cast<std::uintptr_t>(p) % slab_heap::alignment == 0;
+    ok = check(aligned, "alignment") && ok;
+
+    // chunks beyond what the caches keep are freed
+    deallocate_all(blocks, 32);
+    ok = check(slab_heap::page_count() <= pages + used / 4, "chunks returned") && ok;
+
+    // a burst of frees, then as many allocations: the freed objects
+    // are taken back rather than new chunks
+    blocks = allocate_all(800000, 48);
+    size_t peak = slab_heap::page_count();
+    deallocate_all(blocks, 48);
+    blocks = allocate_all(800000, 48);
+    ok = check(slab_heap::page_count() <= peak, "burst reuse") && ok;
+    deallocate_all(blocks, 48);
+
+    // other sizes, including large ones passed to ::operator new
+    for (size_t size : {size_t(0), size_t(1), size_t(17), size_t(256), size_t(257), size_t(100000)}) {
+        void *p = slab_heap::allocate(size);
+        std::memset(p, 0, size);
+        slab_heap::deallocate(p, size);
+    }
+    slab_heap::deallocate(nullptr, 16);
+
+    // in standard containers, node-based ones included
+    {
+        std::vector<vec4, mpp::slab_allocator<vec4>> v(100);
+        std::list<std::string, mpp::slab_allocator<std::string>> l;
+        std::map<int, int, std::less<int>, mpp::slab_allocator<std::pair<const int, int>>> m;
+        for (int i = 0; i < 1000; ++i) {
+            l.emplace_back(std::to_string(i));
+            m[i] = i * 2;
+        }
+        ok = check(reinterpret_cast<std::uintptr_t>(v.data()) % alignof(vec4) == 0, "vector alignment") && ok;
+        ok = check(l.back() == "999" && m[500] == 1000, "containers") && ok;
+    }
+
+    // as the backend of the Mozart allocators
+    {
+        int alive = 0;
+        mpp::plain_allocator_type<payload, 16> plain;
+        mpp::allocator_type<payload, 16> cached;
+        std::vector<payload *> objects;
+        for (int i = 0; i < 100; ++i) {
+            objects.push_back(plain.alloc("plain", alive));
+            objects.push_back(cached.alloc("cached", alive));
+        }
+        ok = check(alive == 200 && objects[198]->text == "plain" && objects[199]->text == "cached",
+                   "allocator types") && ok;
+        for (size_t i = 0; i < objects.size(); i += 2) {
+            plain.free(objects[i]);
+            cached.free(objects[i + 1]);
+        }
+        ok = check(alive == 0, "allocator types free") && ok;
+    }
+
+    // objects allocated by one thread and freed by another
+    pages = slab_heap::page_count();
+    const size_t count = 20000;
+    std::vector<std::vector<void *>> handed(4);
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < 4; ++t)
+        threads.emplace_back([&handed, t]() { handed[t] = allocate_all(count, 48); });
+    for (std::thread &t : threads)
+        t.join();
+    threads.clear();
+
+    std::atomic<bool> intact{true};
+    for (size_t t = 0; t < 4; ++t) {
+        threads.emplace_back([&handed, &intact, t]() {
+            // churn on the objects of another thread
+            std::vector<void *> &mine = handed[(t + 1) % 4];
+            for (size_t i = 0; i < mine.size(); ++i) {
+                if (*static_cast<unsigned char *>(mine[i]) != static_cast<unsigned char>(i))
+                    intact = false;
+            }
+            deallocate_all(mine, 48);
+            for (int round = 0; round < 10; ++round)
+                deallocate_all(allocate_all(mine.size(), 48), 48);
+        });
+    }
+    for (std::thread &t : threads)
+        t.join();
+    ok = check(intact, "cross-thread") && ok;
+
+    // the lists of the exited threads were handed back, and the chunks
+    // beyond what the depot keeps freed
+    ok = check(slab_heap::page_count() <= pages + 4 * count * 48 / slab_heap::page_size / 10, "exited threads") && ok;
+
+    return ok ? 0 : 1;
+}
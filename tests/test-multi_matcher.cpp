@@ -0,0 +1,126 @@
+/**
+ * Mozart++ Template Library
+ * Licensed under Apache 2.0
+ * Copyright (C) 2020-2021 Chengdu Covariant Technologies Co., LTD.
+ * Website: https://covariant.cn/
+ * Github:  https://github.com/chengdu-zhirui/
+ */
+
+#include <mozart++/multi_matcher>
+#include <algorithm>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <tuple>
+#include <vector>
+
+using mpp::string_ref;
+using match = mpp::multi_matcher::match;
+
+std::string random_string(std::mt19937 &rng, size_t length, string_ref alphabet) {
+    std::string s(length, '\0');
+    for (char &c : s) {
+        c = alphabet.data()[rng() % alphabet.size()];
+    }
+    return s;
+}
+
+/**
+ * Try every pattern at every position.
+ */
+std::vector<match> brute_force(string_ref text, const std::vector<std::string> &patterns, bool ignore_case) {
+    std::vector<match> matches;
+    for (size_t i = 0; i != patterns.size(); ++i) {
+        string_ref pattern = patterns[i];
+        if (pattern.empty()) {
+            continue;
+        }
+        for (size_t pos = 0; pos + pattern.size() <= text.size(); ++pos) {
+            string_ref piece = text.substr(pos, pattern.size());
+            if (ignore_case ? piece.equals_ignore_case(pattern) : piece.equals(pattern)) {
+                matches.push_back(match{pos, pattern.size(), i});
+            }
+        }
+    }
+    return matches;
+}
+
+bool same_matches(std::vector<match> lhs, std::vector<match> rhs) {
+    auto key = [](const match &m) {
+        return std::make_tuple(m.position, m.length, m.pattern);
+    };
+    auto less = [&key](const match &a, const match &b) { return key(a) < key(b); };
+    std::sort(lhs.begin(), lhs.end(), less);
+    std::sort(rhs.begin(), rhs.end(), less);
+    return lhs.size() == rhs.size() && std::equal(lhs.begin(), lhs.end(), rhs.begin(),
+                                                  [&key](const match &a, const match &b) {
+                                                      return key(a) == key(b);
+                                                  });
+}
+
+int main() {
+    bool ok = true;
+
+    mpp::multi_matcher keywords({"he", "she", "his", "hers"});
+    auto found = keywords.find_all("ushers");
+    // "she" and "he" end at the same position, the longer one first
+    if (found.size() != 3 || found[0].pattern != 1 || found[1].pattern != 0
+        || found[2].pattern != 3 || found[2].position != 2) {
+        printf("ushers mismatch\n");
+        ok = false;
+    }
+
+    mpp::multi_matcher headers({"content-length", "host", "cookie"}, true);
+    match first{};
+    if (!headers.contains_any("Accept: */*\r\nHOST: example.com\r\n")
+        || !headers.find_first("Cookie: a=1; Host: b", first) || first.pattern != 2 || first.position != 0
+        || headers.contains_any("Accept: */*")) {
+        printf("headers mismatch\n");
+        ok = false;
+    }
+
+    std::mt19937 rng(20201021);
+    const char *alphabets[] = {"ab", "abcAB", "abcdefgh ABCDEFGH@[\x80\xff"};
+    for (int i = 0; i < 3000; ++i) {
+        string_ref alphabet = alphabets[rng() % 3];
+        std::vector<std::string> patterns(rng() % 12 + 1);
+        std::vector<string_ref> refs;
+        for (std::string &pattern : patterns) {
+            pattern = random_string(rng, rng() % 6, alphabet);
+            refs.emplace_back(pattern);
+        }
+        std::string text = random_string(rng, rng() % 300, alphabet);
+        bool ignore_case = rng() % 2 == 0;
+
+        mpp::multi_matcher matcher(refs, ignore_case);
+        if (!same_matches(matcher.find_all(text), brute_force(text, patterns, ignore_case))) {
+            printf("multi_matcher mismatch: [%s]\n", text.c_str());
+            ok = false;
+        }
+    }
+
+    // the SIMD prefix scans against the scalar one
+    for (int i = 0; i < 3000; ++i) {
+        mpp_impl::prefix_filter filter;
+        filter.width = rng() % mpp_impl::prefix_filter::max_width + 1;
+        for (int n = rng() % 6; n >= 0; --n) {
+            for (size_t k = 0; k != filter.width; ++k) {
+                filter.add(k, static_cast<std::uint8_t>(rng() % 8 + 'a'), rng() % 8);
+            }
+        }
+        std::string text = random_string(rng, rng() % 200, "abcdefghijklmnop");
+        const char *begin = text.data(), *end = text.data() + text.size();
+        const char *expected = mpp_impl::scan_prefix_scalar(begin, end, filter);
+        bool same = mpp_impl::scan_prefix(begin, end, filter) == expected;
+#ifdef MOZART_SIMD_SSSE3
+        if (mpp_impl::cpu_features::get().ssse3) {
+            same = same && mpp_impl::scan_prefix_ssse3(begin, end, filter) == expected;
+        }
+#endif
+        if (!same) {
+            printf("prefix filter mismatch: [%s]\n", text.c_str());
+            ok = false;
+        }
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,132 @@
+/**
+ * Mozart++ Template Library
+ * Licensed under Apache 2.0
+ * Copyright (C) 2020-2021 Chengdu Covariant Technologies Co., LTD.
+ * Website: https://covariant.cn/
+ * Github:  https://github.com/chengdu-zhirui/
+ */
+
+#include <mozart++/small_string>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <unordered_set>
+#include <utility>
+
+using mpp::string_ref;
+
+static size_t allocations = 0;
+
+template <typename T>
+struct counting_allocator : std::allocator<T> {
+    template <typename U>
+    struct rebind {
+        using other = counting_allocator<U>;
+    };
+
+    T *allocate(size_t n) {
+        ++allocations;
+        return std::allocator<T>::allocate(n);
+    }
+};
+
+using small = mpp::small_string<15, counting_allocator>;
+
+bool check(const small &s, const std::string &expected, const char *what) {
+    if (s.ref() != expected || s.size() != expected.size() || s.c_str()[s.size()] != '\0'
+        || s.is_inline() != (s.capacity() == 15)) {
+        printf("%s: [%s], expected [%s]\n", what, s.c_str(), expected.c_str());
+        return false;
+    }
+    return true;
+}
+
+int main() {
+    bool ok = true;
+
+    small a("short token");
+    ok = check(a, "short token", "inline construct") && ok;
+    ok = (a.is_inline() && allocations == 0) && ok;
+
+    small b(std::move(a));
+    ok = check(b, "short token", "inline move") && check(a, "", "moved-from") && ok;
+
+    std::string expected = "short token";
+    for (int i = 0; i != 40; ++i) {
+        b += char('a' + i % 26);
+        expected += char('a' + i % 26);
+    }
+    ok = check(b, expected, "spill to heap") && !b.is_inline() && ok;
+
+    // moving a heap buffer hands it over
+    size_t before = allocations;
+    const char *buffer = b.data();
+    small c(std::move(b));
+    small d;
+    d = std::move(c);
+    ok = (allocations == before && d.data() == buffer) && check(d, expected, "heap move") && ok;
+
+    // appending a piece of itself, across a reallocation
+    d.append(d.ref().substr(5, 20));
+    expected += expected.substr(5, 20);
+    ok = check(d, expected, "self append") && ok;
+
+    d = d.ref().substr(0, 4);
+    d.shrink_to_fit();
+    ok = check(d, "shor", "shrink") && d.is_inline() && ok;
+
+    small e(d);
+    mpp::upper_in_place(e);
+    ok = check(e, "SHOR", "copy and upper") && check(d, "shor", "copy source") && ok;
+    ok = (e.ref().equals_ignore_case(d) && e != d && e.ref().find('O') == 2) && ok;
+
+    std::unordered_set<mpp::small_string<>> set{"alpha", "beta", "alpha"};
+    ok = (set.size() == 2 && set.count("beta") == 1) && ok;
+
+    // random edits against std::string
+    std::mt19937 rng(20201104);
+    small s;
+    std::string ref;
+    for (int i = 0; i != 100000; ++i) {
+        switch (rng() % 6) {
+            case 0:
+                s.push_back('x');
+                ref.push_back('x');
+                break;
+            case 1:
+                if (!ref.empty()) {
+                    s.pop_back();
+                    ref.pop_back();
+                }
+                break;
+            case 2: {
+                std::string piece(rng() % 20, char('a' + rng() % 26));
+                s += piece;
+                ref += piece;
+                break;
+            }
+            case 3: {
+                size_t size = rng() % 40;
+                s.resize(size, '-');
+                ref.resize(size, '-');
+                break;
+            }
+            case 4:
+                if (rng() % 8 == 0) {
+                    s.clear();
+                    ref.clear();
+                }
+                break;
+            default: {
+                small t(std::move(s));
+                s = std::move(t);
+                break;
+            }
+        }
+        if (!check(s, ref, "random edit")) {
+            ok = false;
+            break;
+        }
+    }
+    return ok ? 0 : 1;
+}
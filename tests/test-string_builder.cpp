@@ -0,0 +1,105 @@
+/**
+ * Mozart++ Template Library
+ * Licensed under Apache 2.0
+ * Copyright (C) 2020-2021 Chengdu Covariant Technologies Co., LTD.
+ * Website: https://covariant.cn/
+ * Github:  https://github.com/chengdu-zhirui/
+ */
+
+#include <mozart++/string_builder>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <utility>
+
+using mpp::string_ref;
+
+struct iovec_like {
+    void *iov_base;
+    size_t iov_len;
+};
+
+bool check(const mpp::string_builder &builder, const std::string &expected, const char *what) {
+    std::string joined;
+    size_t total = 0;
+    for (string_ref segment : builder.segments()) {
+        joined += segment.str();
+        total += segment.size();
+    }
+    iovec_like iov[4];
+    std::string gathered;
+    for (size_t first = 0, n; (n = builder.fill_iovec(iov, 4, first)) != 0; first += n) {
+        for (size_t i = 0; i != n; ++i) {
+            gathered.append(static_cast<const char *>(iov[i].iov_base), iov[i].iov_len);
+        }
+    }
+    if (builder.str() != expected || joined != expected || gathered != expected
+        || total != builder.size() || builder.empty() != expected.empty()) {
+        printf("%s: [%s], expected [%s]\n", what, builder.str().c_str(), expected.c_str());
+        return false;
+    }
+    return true;
+}
+
+int main() {
+    bool ok = true;
+
+    mpp::string_builder builder(64);
+    std::string expected;
+    std::mt19937 rng(20201105);
+    for (int i = 0; i != 2000; ++i) {
+        std::string piece(rng() % 150, char('a' + rng() % 26));
+        switch (rng() % 4) {
+            case 0:
+                builder.append(piece);
+                break;
+            case 1:
+                builder << piece;
+                break;
+            case 2:
+                builder.append(piece.size(), piece.empty() ? 'x' : piece[0]);
+                piece.assign(piece.size(), piece.empty() ? 'x' : piece[0]);
+                break;
+            default:
+                builder.push_back('#');
+                piece = "#";
+                break;
+        }
+        expected += piece;
+    }
+    ok = check(builder, expected, "appends") && ok;
+    // chunks are filled up before a new one is taken,
+    // so adjacent appends share one segment
+    ok = (builder.segments().size() < 20) && ok;
+
+    builder.clear();
+    ok = check(builder, "", "clear") && ok;
+    // the chunks start small again after clear()
+    for (int i = 0; i != 100; ++i) {
+        builder.push_back('c');
+    }
+    ok = check(builder, std::string(100, 'c'), "refill") && ok;
+    ok = (builder.segments().size() == 2 && builder.segments()[0].size() == 64) && ok;
+    builder.clear();
+
+    static const std::string external = "external text";
+    builder << "id=" << 42 << ' ' << 1.5 << ' ' << true << ' ';
+    builder.append_ref(external);
+    builder << '!';
+    ok = check(builder, "id=42 1.5 1 external text!", "values and references") && ok;
+    ok = (builder.segments().size() == 3 && builder.segments()[1].data() == external.data()) && ok;
+
+    mpp::string_builder formatted;
+    mpp::format(formatted, "[{}] {} ", "INFO", 42);
+    mpp::format_to(formatted, "{x}|{.2}", 255, 3.14159);
+    mpp::format_to(formatted, mpp_cached_format(" {:-5|.}"), "ab");
+    mpp::format(formatted, mpp_format_string("{} ok"), 7);
+    ok = check(formatted, "[INFO] 42 0xff|3.14 ab...7 ok", "format sink") && ok;
+
+    mpp::string_builder moved(std::move(formatted));
+    moved << "?";
+    formatted << "again";
+    ok = check(moved, "[INFO] 42 0xff|3.14 ab...7 ok?", "moved") && check(formatted, "again", "moved-from") && ok;
+
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,151 @@
+/**
+ * Mozart++ Template Library
+ * Licensed under Apache 2.0
+ * Copyright (C) 2020-2021 Chengdu Covariant Technologies Co., LTD.
+ * Website: https://covariant.cn/
+ * Github:  https://github.com/chengdu-zhirui/
+ */
+
+#include <mozart++/string_pool>
+#include <cstdio>
+#include <random>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+using mpp::string_ref;
+
+bool check_hash() {
+    std::mt19937 rng(20201101);
+    bool ok = true;
+
+    // equal strings hash equally wherever they are stored,
+    // and every length and alignment goes through the same code
+    std::string buffer(300, '\0');
+    for (char &c : buffer) {
+        c = static_cast<char>(rng());
+    }
+    std::set<size_t> hashes;
+    for (size_t length = 0; length != 200; ++length) {
+        std::string copy = buffer.substr(0, length);
+        std::string shifted = "x" + copy;
+        size_t h = string_ref(copy).hash();
+        if (h != string_ref(shifted).substr(1).hash() || h != std::hash<string_ref>()(copy)) {
+            printf("hash differs for equal strings (length %zu)\n", length);
+            ok = false;
+        }
+        hashes.insert(h);
+    }
+
+    // single bit flips change the value
+    std::string str = "interned symbol name";
+    size_t base = string_ref(str).hash();
+    for (size_t i = 0; i != str.size() * 8; ++i) {
+        str[i / 8] ^= char(1 << (i % 8));
+        hashes.insert(string_ref(str).hash());
+        if (string_ref(str).hash() == base) {
+            printf("bit flip %zu not detected\n", i);
+            ok = false;
+        }
+        str[i / 8] ^= char(1 << (i % 8));
+    }
+    if (hashes.size() != 200 + str.size() * 8) {
+        printf("hash collisions: %zu distinct\n", hashes.size());
+        ok = false;
+    }
+
+    std::unordered_map<string_ref, int> map;
+    map["alpha"] = 1;
+    map["beta"] = 2;
+    std::string key = "alpha";
+    if (map.count(key) != 1 || map[string_ref(key)] != 1 || map.size() != 2) {
+        printf("unordered_map<string_ref> lookup failed\n");
+        ok = false;
+    }
+    return ok;
+}
+
+bool check_arena() {
+    mpp::arena_allocator arena(256);
+    bool ok = true;
+    char *last = nullptr;
+    for (int i = 0; i != 1000; ++i) {
+        auto *d = arena.allocate<double>(i % 7 + 1);
+        char *c = arena.allocate<char>(i % 3 + 1);
+        if (reinterpret_cast<std::uintptr_t>(d) % alignof(double) != 0 || c == last) {
+            printf("arena allocation %d misaligned or reused\n", i);
+            ok = false;
+        }
+        *d = i;
+        *c = 'x';
+        last = c;
+    }
+    char *big = arena.allocate<char>(100000);
+    big[0] = big[99999] = 'y';
+    if (arena.allocated_bytes() < 100000) {
+        printf("arena did not account for a large block\n");
+        ok = false;
+    }
+    arena.release();
+    return ok && arena.allocated_bytes() == 0;
+}
+
+bool check_pool() {
+    mpp::string_pool pool(256);
+    std::mt19937 rng(20201102);
+    bool ok = true;
+
+    std::vector<std::string> words;
+    for (int i = 0; i != 5000; ++i) {
+        words.push_back("symbol_" + std::to_string(rng() % 2000));
+    }
+    std::unordered_map<std::string, const char *> expected;
+    for (const std::string &word : words) {
+        string_ref pooled = pool.intern(word);
+        if (!pooled.equals(word) || pooled.data() == word.data()) {
+            printf("interned copy of %s is wrong\n", word.c_str());
+            ok = false;
+        }
+        auto it = expected.emplace(word, pooled.data()).first;
+        if (it->second != pooled.data()) {
+            printf("%s interned twice\n", word.c_str());
+            ok = false;
+        }
+    }
+    if (pool.size() != expected.size()) {
+        printf("pool size %zu, expected %zu\n", pool.size(), expected.size());
+        ok = false;
+    }
+
+    string_ref found;
+    std::string probe = words[0];
+    if (!pool.lookup(probe, found) || found.data() != expected[probe]
+        || pool.owns(probe) || !pool.owns(found) || pool.contains("symbol_x")) {
+        printf("pool lookup failed\n");
+        ok = false;
+    }
+    if (pool.intern("").data() != nullptr || !pool.contains("")) {
+        printf("empty string not interned as string_ref{}\n");
+        ok = false;
+    }
+
+    mpp::string_pool moved(std::move(pool));
+    if (moved.size() != expected.size() || !pool.empty() || moved.intern(probe).data() != expected[probe]) {
+        printf("moving the pool lost strings\n");
+        ok = false;
+    }
+    moved.clear();
+    if (!moved.empty() || moved.contains(probe) || moved.memory_usage() != 0) {
+        printf("pool not cleared\n");
+        ok = false;
+    }
+    return ok;
+}
+
+int main() {
+    bool ok = check_hash();
+    ok = check_arena() && ok;
+    ok = check_pool() && ok;
+    return ok ? 0 : 1;
+}
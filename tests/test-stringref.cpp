@@ -8,6 +8,11 @@
 
 #include <mozart++/string>
 #include <iostream>
+#include <random>
+#include <cstring>
+#include <vector>
+#include <algorithm>
+#include <cctype>
 
 using mpp::string_ref;
 
@@ -34,10 +39,493 @@ void process_command(string_ref command) {
     }
 }
 
+/**
+ * The scalar string_ref::find before the SIMD searches.
+ */
+size_t reference_find(string_ref hay, string_ref str, size_t start_index = 0) {
+    if (start_index > hay.size()) {
+        return string_ref::npos;
+    }
+    for (size_t i = start_index; i + str.size() <= hay.size(); ++i) {
+        if (std::memcmp(hay.data() + i, str.data(), str.size()) == 0) {
+            return i;
+        }
+    }
+    return string_ref::npos;
+}
+
+std::string random_string(std::mt19937 &rng, size_t length, const char *alphabet) {
+    size_t n = std::strlen(alphabet);
+    std::string s(length, '\0');
+    for (char &c : s) {
+        c = alphabet[rng() % n];
+    }
+    return s;
+}
+
+bool check_find() {
+    std::mt19937 rng(20201017);
+    const char *alphabets[] = {"ab", "abcd", "abcdefghijklmnopqrstuvwxyz \n"};
+    bool ok = true;
+
+    auto check = [&ok](const std::string &hay, const std::string &needle, size_t start) {
+        size_t expected = reference_find(hay, needle, start);
+        size_t actual = string_ref(hay).find(needle, start);
+        if (expected != actual) {
+            printf("find mismatch: %zu != %zu (hay %zu, needle %zu, start %zu)\n",
+                   actual, expected, hay.size(), needle.size(), start);
+            ok = false;
+        }
+        if (needle.size() < 2 || start > hay.size() || hay.size() - start < needle.size()) {
+            return;
+        }
+        // check every search, not only the one the CPU chooses
+        const char *begin = hay.data() + start;
+        const char *end = hay.data() + hay.size();
+        std::vector<const char *> results{
+                mpp_impl::search_kmp(begin, end, needle.data(), needle.size()),
+                mpp_impl::search_naive(begin, end, needle.data(), needle.size()),
+                mpp_impl::search_horspool(begin, end, needle.data(), needle.size()),
+        };
+#ifdef MOZART_SIMD_SSE2
+        results.push_back(mpp_impl::search_sse2(begin, end, needle.data(), needle.size()));
+#endif
+#ifdef MOZART_SIMD_AVX2
+        if (mpp_impl::cpu_features::get().avx2) {
+            results.push_back(mpp_impl::search_avx2(begin, end, needle.data(), needle.size()));
+        }
+#endif
+        for (const char *result : results) {
+            size_t index = result == nullptr ? string_ref::npos : result - hay.data();
+            if (index != expected) {
+                printf("search mismatch: %zu != %zu (hay %zu, needle %zu, start %zu)\n",
+                       index, expected, hay.size(), needle.size(), start);
+                ok = false;
+            }
+        }
+    };
+
+    for (int i = 0; i < 20000; ++i) {
+        const char *alphabet = alphabets[rng() % 3];
+        std::string hay = random_string(rng, rng() % 1200, alphabet);
+        std::string needle;
+        if (!hay.empty() && rng() % 2 == 0) {
+            // a needle that surely occurs
+            size_t pos = rng() % hay.size();
+            needle = hay.substr(pos, rng() % 600);
+        } else {
+            needle = random_string(rng, rng() % (i % 10 == 0 ? 600 : 12), alphabet);
+        }
+        check(hay, needle, rng() % (hay.size() + 2));
+    }
+
+    // needles that defeat the first and last byte filter
+    std::string hay(100000, 'a');
+    for (size_t n : {2, 3, 17, 300, 5000}) {
+        std::string needle = std::string(n - 1, 'a') + 'b';
+        check(hay, needle, 0);
+        check(hay + needle, needle, 0);
+        check(hay + needle + hay, needle, 12345);
+        check(hay, std::string("b") + std::string(n - 2, 'a') + "a", 0);
+    }
+    return ok;
+}
+
+bool check_char_set() {
+    std::mt19937 rng(20201018);
+    bool ok = true;
+
+    for (int i = 0; i < 20000; ++i) {
+        // bytes from the whole range, to cover the upper nibble table
+        std::string hay(rng() % 300, '\0');
+        std::string chars(rng() % 8, '\0');
+        unsigned spread = i % 2 == 0 ? 8 : 256;
+        for (char &c : hay) {
+            c = static_cast<char>(rng() % spread * (256 / spread) + (i % 4 == 0 ? 0 : ' '));
+        }
+        for (char &c : chars) {
+            c = static_cast<char>(rng() % spread * (256 / spread) + (i % 4 == 0 ? 0 : ' '));
+        }
+        mpp::char_set set(chars);
+        string_ref ref(hay);
+        size_t start = rng() % (hay.size() + 2);
+        size_t last_start = i % 3 == 0 ? string_ref::npos : start;
+
+        size_t expected[] = {
+                hay.find_first_of(chars, start),
+                hay.find_first_not_of(chars, start),
+                last_start == 0 ? std::string::npos : hay.find_last_of(chars, last_start - 1),
+                last_start == 0 ? std::string::npos : hay.find_last_not_of(chars, last_start - 1),
+        };
+        size_t actual[] = {
+                ref.find_first_of(set, start),
+                ref.find_first_not_of(set, start),
+                ref.find_last_of(set, last_start),
+                ref.find_last_not_of(set, last_start),
+        };
+#ifdef MOZART_SIMD_SSSE3
+        // AVX2 machines only run the SSSE3 scanner on the tails
+        if (mpp_impl::cpu_features::get().ssse3) {
+            const char *begin = hay.data(), *end = hay.data() + hay.size();
+            for (bool in_set : {true, false}) {
+                if (mpp_impl::scan_first_ssse3(begin, end, set.bytes(), in_set)
+                    != mpp_impl::scan_first_scalar(begin, end, set.bytes(), in_set)
+                    || mpp_impl::scan_last_ssse3(begin, end, set.bytes(), in_set)
+                       != mpp_impl::scan_last_scalar(begin, end, set.bytes(), in_set)) {
+                    printf("ssse3 scan mismatch (hay %zu)\n", hay.size());
+                    ok = false;
+                }
+            }
+        }
+#endif
+        for (int k = 0; k < 4; ++k) {
+            if (expected[k] != actual[k]) {
+                printf("char_set mismatch %d: %zu != %zu (hay %zu, start %zu)\n",
+                       k, actual[k], expected[k], hay.size(), last_start);
+                ok = false;
+            }
+        }
+    }
+
+    if (!string_ref(" \t hello world \r\n").trim().equals("hello world")
+        || !string_ref("--==x==--").trim(mpp::char_set("-=")).equals("x")
+        || !string_ref("xxx").trim("x").empty()) {
+        printf("trim mismatch\n");
+        ok = false;
+    }
+    return ok;
+}
+
+template <typename Range>
+bool same_pieces(const Range &range, const std::vector<string_ref> &expected) {
+    size_t i = 0;
+    for (string_ref piece : range) {
+        if (i == expected.size() || piece.data() != expected[i].data() || piece.size() != expected[i].size()) {
+            return false;
+        }
+        ++i;
+    }
+    return i == expected.size();
+}
+
+bool check_lazy_split() {
+    std::mt19937 rng(20201019);
+    bool ok = true;
+
+    for (int i = 0; i < 20000; ++i) {
+        std::string str = random_string(rng, rng() % 40, "ab,;");
+        int max_split = static_cast<int>(rng() % 8) - 1;
+        bool keep_empty = rng() % 2 == 0;
+        string_ref ref(str);
+
+        std::vector<string_ref> by_char;
+        ref.split(by_char, ',', max_split, keep_empty);
+        std::vector<string_ref> by_string;
+        ref.split(by_string, ",;", max_split, keep_empty);
+
+        // a char_set splits like a char, only at more places
+        std::string replaced = str;
+        std::replace(replaced.begin(), replaced.end(), ';', ',');
+        std::vector<string_ref> by_set;
+        string_ref(replaced).split(by_set, ',', max_split, keep_empty);
+        for (string_ref &piece : by_set) {
+            piece = string_ref(str.data() + (piece.data() - replaced.data()), piece.size());
+        }
+        mpp::char_set set(",;");
+
+        if (!same_pieces(ref.lazy_split(',', max_split, keep_empty), by_char)
+            || !same_pieces(ref.lazy_split(",;", max_split, keep_empty), by_string)
+            || !same_pieces(ref.lazy_split(set, max_split, keep_empty), by_set)) {
+            printf("lazy_split mismatch: [%s] %d %d\n", str.c_str(), max_split, keep_empty);
+            ok = false;
+        }
+    }
+
+    // stop early and keep the rest
+    mpp::iterator_range<mpp::split_iterator<char>> fields = string_ref("id,name,age,city").lazy_split(',');
+    auto it = fields.begin();
+    ++it;
+    if (!it->equals("name") || !it.rest().equals("age,city")
+        || string_ref("a:b").lazy_split(':').to_vector().size() != 2) {
+        printf("lazy_split iterator mismatch\n");
+        ok = false;
+    }
+    return ok;
+}
+
+/**
+ * The find_ignore_case before the case folding search.
+ */
+size_t reference_find_ignore_case(string_ref hay, string_ref str, size_t start_index = 0) {
+    if (start_index > hay.size()) {
+        return string_ref::npos;
+    }
+    for (size_t i = start_index; i + str.size() <= hay.size(); ++i) {
+        size_t k = 0;
+        while (k < str.size() && std::tolower(hay.data()[i + k]) == std::tolower(str.data()[k])) {
+            ++k;
+        }
+        if (k == str.size()) {
+            return i;
+        }
+    }
+    return string_ref::npos;
+}
+
+bool check_ignore_case() {
+    std::mt19937 rng(20201020);
+    // letters, and the bytes right next to them
+    const char *alphabets[] = {"aA", "abAB@[`{", "abcdefxyzABCDEFXYZ @[`{\x80\xc1\xe1"};
+    bool ok = true;
+
+    for (int i = 0; i < 20000; ++i) {
+        const char *alphabet = alphabets[rng() % 3];
+        std::string hay = random_string(rng, rng() % 600, alphabet);
+        std::string needle;
+        if (!hay.empty() && rng() % 2 == 0) {
+            size_t pos = rng() % hay.size();
+            needle = hay.substr(pos, rng() % 40);
+            for (char &c : needle) {
+                c = rng() % 2 == 0 ? static_cast<char>(std::toupper(c)) : c;
+            }
+        } else {
+            needle = random_string(rng, rng() % (i % 10 == 0 ? 400 : 6), alphabet);
+        }
+        size_t start = rng() % (hay.size() + 1);
+        size_t expected = reference_find_ignore_case(hay, needle, start);
+        size_t actual = string_ref(hay).find_ignore_case(needle, start);
+        if (expected != actual) {
+            printf("find_ignore_case mismatch: %zu != %zu (hay %zu, needle %zu)\n",
+                   actual, expected, hay.size(), needle.size());
+            ok = false;
+        }
+        if (needle.size() >= 2 && hay.size() - start >= needle.size()) {
+            const char *begin = hay.data() + start, *end = hay.data() + hay.size();
+            const char *p = mpp_impl::search_horspool_ignore_case(begin, end, needle.data(), needle.size());
+            if ((p == nullptr ? string_ref::npos : p - hay.data()) != expected) {
+                printf("horspool ignore case mismatch\n");
+                ok = false;
+            }
+        }
+
+        std::string other = needle;
+        if (!other.empty() && rng() % 2 == 0) {
+            other[rng() % other.size()] = alphabet[rng() % std::strlen(alphabet)];
+        }
+        int compared = string_ref(needle).compare_ignore_case(other);
+        int reference = string_ref(string_ref(needle).lower()).compare(string_ref(other).lower());
+        if (compared != reference) {
+            printf("compare_ignore_case mismatch: [%s] [%s]\n", needle.c_str(), other.c_str());
+            ok = false;
+        }
+    }
+
+    string_ref header("Content-Type: text/plain");
+    if (!header.contains_ignore_case("CONTENT-type") || header.find_ignore_case('Y') != 9
+        || !header.startswith_ignore_case("content-") || !header.endswith_ignore_case("PLAIN")
+        || header.rfind_ignore_case('C') != 0) {
+        printf("ignore case mismatch\n");
+        ok = false;
+    }
+    return ok;
+}
+
+size_t reference_count(string_ref hay, string_ref str, bool overlapping) {
+    size_t count = 0;
+    for (size_t i = 0; i + str.size() <= hay.size();) {
+        if (hay.substr(i, str.size()).equals(str)) {
+            ++count;
+            i += overlapping ? 1 : str.size();
+        } else {
+            ++i;
+        }
+    }
+    return count;
+}
+
+bool check_count() {
+    std::mt19937 rng(20201022);
+    bool ok = true;
+
+    for (int i = 0; i < 5000; ++i) {
+        // long enough to flush the SIMD byte counters
+        std::string hay = random_string(rng, rng() % (i % 10 == 0 ? 20000 : 300), i % 2 == 0 ? "ab" : "abc\n");
+        char c = "abc\n"[rng() % 4];
+        size_t expected = static_cast<size_t>(std::count(hay.begin(), hay.end(), c));
+        bool same = string_ref(hay).count(c) == expected;
+#ifdef MOZART_SIMD_SSE2
+        same = same && mpp_impl::count_byte_sse2(hay.data(), hay.data() + hay.size(), c) == expected;
+#endif
+        if (!same) {
+            printf("count(char) mismatch (hay %zu)\n", hay.size());
+            ok = false;
+        }
+
+        std::string needle = random_string(rng, rng() % 5 + 1, "ab");
+        for (bool overlapping : {true, false}) {
+            if (string_ref(hay).count(needle, overlapping) != reference_count(hay, needle, overlapping)) {
+                printf("count(string) mismatch: %s %d\n", needle.c_str(), overlapping);
+                ok = false;
+            }
+        }
+    }
+
+    // dense matches switch to Knuth-Morris-Pratt
+    std::string hay(200000, 'a');
+    hay[123456] = 'b';
+    for (size_t n : {2, 3, 50, 1000}) {
+        std::string needle(n, 'a');
+        for (bool overlapping : {true, false}) {
+            if (string_ref(hay).count(needle, overlapping) != reference_count(hay, needle, overlapping)) {
+                printf("dense count mismatch: %zu %d\n", n, overlapping);
+                ok = false;
+            }
+        }
+    }
+    return ok;
+}
+
+template <typename Class>
+bool check_class(const std::string &str, size_t start, Class cls, int (*reference)(int)) {
+    string_ref ref(str);
+    auto ref_pred = [reference](char c) { return reference(static_cast<unsigned char>(c)) != 0; };
+    mpp::function<bool(char)> erased = ref_pred;
+    size_t expected = ref.find_if(erased, start);
+    size_t expected_not = ref.find_if_not(erased, start);
+    return ref.find_if(cls, start) == expected && ref.find_if_not(cls, start) == expected_not
+           && ref.find_if(ref_pred, start) == expected
+           && ref.take_while(cls).size() == std::min(ref.size(), ref.find_if_not(ref_pred))
+           && ref.drop_until(cls).data() == ref.drop_until(ref_pred).data();
+}
+
+bool check_predicates() {
+    std::mt19937 rng(20201023);
+    bool ok = true;
+
+    for (int i = 0; i < 5000; ++i) {
+        std::string str(rng() % 100, '\0');
+        for (char &c : str) {
+            // mostly printable, sometimes any byte
+            c = static_cast<char>(i % 4 == 0 ? rng() % 256 : rng() % 96 + 32);
+        }
+        if (i % 3 == 0 && !str.empty()) {
+            // long runs of one class
+            std::fill(str.begin(), str.begin() + rng() % str.size(), "0a Z"[rng() % 4]);
+        }
+        size_t start = rng() % (str.size() + 2);
+        if (!check_class(str, start, mpp::ascii_digit(), std::isdigit)
+            || !check_class(str, start, mpp::ascii_xdigit(), std::isxdigit)
+            || !check_class(str, start, mpp::ascii_upper(), std::isupper)
+            || !check_class(str, start, mpp::ascii_lower(), std::islower)
+            || !check_class(str, start, mpp::ascii_alpha(), std::isalpha)
+            || !check_class(str, start, mpp::ascii_alnum(), std::isalnum)
+            || !check_class(str, start, mpp::ascii_space(), std::isspace)) {
+            printf("predicate mismatch: [%s]\n", str.c_str());
+            ok = false;
+        }
+    }
+
+    mpp::char_set separators(",;");
+    string_ref line("  key1=value,key2;rest");
+    if (!line.drop_while(mpp::ascii_space()).take_while(mpp::ascii_alnum()).equals("key1")
+        || !line.take_until(separators).equals("  key1=value")
+        || line.find_if(separators) != line.find_first_of(separators)
+        || !line.drop_until([](char c) { return c == ';'; }).equals(";rest")) {
+        printf("predicate mismatch\n");
+        ok = false;
+    }
+    return ok;
+}
+
+bool check_case() {
+    std::mt19937 rng(20201024);
+    bool ok = true;
+
+    for (int i = 0; i < 5000; ++i) {
+        std::string str(rng() % 200, '\0');
+        for (char &c : str) {
+            c = static_cast<char>(rng() % 256);
+        }
+        string_ref ref(str);
+        std::string lower = ref.lower_locale();
+        std::string upper = ref.upper_locale();
+
+        std::string buffer(str.size(), '\0');
+        std::string in_place = str;
+        mpp::lower_in_place(in_place);
+        bool same = ref.lower() == lower && ref.lower_to(&buffer[0]).equals(lower) && in_place == lower
+                    && ref.upper() == upper && ref.upper_to(&buffer[0]).equals(upper)
+                    && string_ref(lower).is_lower() && string_ref(upper).is_upper()
+                    && ref.is_lower() == (lower == str) && ref.is_upper() == (upper == str);
+#ifdef MOZART_SIMD_SSE2
+        mpp_impl::change_case_sse2(str.data(), &buffer[0], str.size(), 'a');
+        same = same && buffer == upper;
+#endif
+        mpp::upper_in_place(in_place);
+        if (!same || in_place != upper) {
+            printf("case conversion mismatch (size %zu)\n", str.size());
+            ok = false;
+        }
+    }
+    return ok;
+}
+
+int sign(int x) {
+    return (x > 0) - (x < 0);
+}
+
+bool check_numeric() {
+    bool ok = true;
+    const char *ordered[] = {"", "a", "a0", "a00", "a1", "a01", "a001", "a2", "a9", "a10", "a010", "a10b",
+                             "a10b2", "a10b10", "a11", "a99", "a100", "a0100", "ab", "b", "file1.txt",
+                             "file2.txt", "file10.txt", "v1.2.9", "v1.2.10", "v1.10.0"};
+    size_t count = sizeof(ordered) / sizeof(ordered[0]);
+    for (size_t i = 0; i != count; ++i) {
+        for (size_t j = 0; j != count; ++j) {
+            string_ref a(ordered[i]), b(ordered[j]);
+            int expected = i < j ? -1 : (i > j ? 1 : 0);
+            if (sign(a.compare_numeric(b)) != expected || sign(a.numeric_key().compare(b.numeric_key())) != expected) {
+                printf("compare_numeric(%s, %s) != %d\n", ordered[i], ordered[j], expected);
+                ok = false;
+            }
+        }
+    }
+
+    // the sort key must agree with compare_numeric everywhere,
+    // including on '\0' and on other bytes around the digits
+    std::mt19937 rng(20201103);
+    const char alphabet[] = {'0', '0', '1', '9', 'a', '/', ':', '\0', '\xff'};
+    for (int i = 0; i < 200000; ++i) {
+        std::string a(rng() % 8, '\0'), b(rng() % 8, '\0');
+        for (char &c : a) {
+            c = alphabet[rng() % sizeof(alphabet)];
+        }
+        for (char &c : b) {
+            c = alphabet[rng() % sizeof(alphabet)];
+        }
+        int r = sign(string_ref(a).compare_numeric(b));
+        if (r != -sign(string_ref(b).compare_numeric(a)) || (r == 0 && a != b)
+            || r != sign(string_ref(a).numeric_key().compare(string_ref(b).numeric_key()))) {
+            printf("numeric key mismatch: [%s] [%s]\n", a.c_str(), b.c_str());
+            ok = false;
+            break;
+        }
+    }
+    return ok;
+}
+
 int main() {
     process_command("I love you");
     process_command("run rm -rf");
     process_command("sum 12345");
     process_command("run f**k");
-    return 0;
+    bool ok = check_find();
+    ok = check_char_set() && ok;
+    ok = check_lazy_split() && ok;
+    ok = check_ignore_case() && ok;
+    ok = check_count() && ok;
+    ok = check_predicates() && ok;
+    ok = check_case() && ok;
+    ok = check_numeric() && ok;
+    return ok ? 0 : 1;
 }